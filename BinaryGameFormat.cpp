@@ -0,0 +1,183 @@
+#include "BinaryGameFormat.h"
+
+namespace
+{
+
+const quint8 cStandardPositionTag = 0;
+const quint8 cCustomPositionTag = 1;
+const int cBoardSize = 8;
+const quint32 cMaxFenTailLength = 64;
+
+quint8 pieceToNibble(ChessPiece piece)
+{
+   if(piece.type()==ptNone) return 0;
+   return piece.type() | (piece.color()==pcBlack ? 8 : 0);
+}
+
+ChessPiece nibbleToPiece(quint8 nibble)
+{
+   PieceType type = nibble & 7;
+   if(type==ptNone || type>ptPawn) return ChessPiece();
+   return ChessPiece(type | ((nibble & 8) ? pcBlack : pcWhite));
+}
+
+}
+
+namespace BinaryGameFormat
+{
+
+quint16 packMove(const ChessMove& move)
+{
+   assert(move.from.col>=1 && move.from.col<=cBoardSize);
+   //
+   quint16 from = (move.from.row-1)*cBoardSize + (move.from.col-1);
+   quint16 to = (move.to.row-1)*cBoardSize + (move.to.col-1);
+   return from | (to<<6) | ((quint16)(move.promotion & ptMask)<<12);
+}
+
+ChessMove unpackMove(quint16 packed)
+{
+   ChessMove move;
+   move.from = ChessCoord((packed & 7) + 1, ((packed>>3) & 7) + 1);
+   move.to = ChessCoord(((packed>>6) & 7) + 1, ((packed>>9) & 7) + 1);
+   move.promotion = (packed>>12) & ptMask;
+   return move;
+}
+
+void writeUint16(QByteArray& out, quint16 value)
+{
+   out.append((char)(value & 0xFF));
+   out.append((char)(value>>8));
+}
+
+bool readUint16(const char *&p, const char *end, quint16& value)
+{
+   if(end-p<2) return false;
+   value = (quint8)p[0] | ((quint16)(quint8)p[1]<<8);
+   p += 2;
+   return true;
+}
+
+void writeVarUint(QByteArray& out, quint32 value)
+{
+   while(value>=0x80)
+   {
+      out.append((char)((value & 0x7F) | 0x80));
+      value >>= 7;
+   }
+   out.append((char)value);
+}
+
+bool readVarUint(const char *&p, const char *end, quint32& value)
+{
+   value = 0;
+   for(unsigned shift=0; shift<35; shift+=7)
+   {
+      if(p>=end) return false;
+      quint8 b = (quint8)*p++;
+      value |= (quint32)(b & 0x7F)<<shift;
+      if((b & 0x80)==0) return true;
+   }
+   return false; // too long, damaged data
+}
+
+void writePosition(QByteArray& out, const ChessPosition& position)
+{
+   std::string fen = position.toString();
+   if(fen==cStandardInitialFen)
+   {
+      out.append((char)cStandardPositionTag);
+      return;
+   }
+   //
+   out.append((char)cCustomPositionTag);
+   //
+   // cells go in FEN order (8th row first), two cells per byte
+   ChessCoord coord;
+   for(coord.row=cBoardSize; coord.row>=1; --coord.row)
+   {
+      for(coord.col=1; coord.col<=cBoardSize; coord.col+=2)
+      {
+         quint8 lo = pieceToNibble(position.cell(coord));
+         quint8 hi = pieceToNibble(position.cell(ChessCoord(coord.col+1, coord.row)));
+         out.append((char)(lo | (hi<<4)));
+      }
+   }
+   //
+   // side to move, castling, en passant square and move counters
+   // are stored as they appear in FEN, they take only a few bytes
+   size_t pos = fen.find(' ');
+   std::string tail = pos==std::string::npos ? std::string() : fen.substr(pos+1);
+   writeVarUint(out, tail.length());
+   out.append(tail.c_str(), tail.length());
+}
+
+bool readPosition(const char *&p, const char *end, ChessPosition& position)
+{
+   if(p>=end) return false;
+   quint8 tag = (quint8)*p++;
+   //
+   if(tag==cStandardPositionTag)
+   {
+      position = cStandardInitialPosition;
+      return true;
+   }
+   if(tag!=cCustomPositionTag) return false;
+   //
+   const int cBoardBytes = cBoardSize*cBoardSize/2;
+   if(end-p<cBoardBytes) return false;
+   //
+   std::string fen;
+   fen.reserve(96);
+   for(int row=0; row<cBoardSize; ++row)
+   {
+      if(row>0) fen.push_back('/');
+      int nEmpty = 0;
+      for(int col=0; col<cBoardSize; ++col)
+      {
+         quint8 b = (quint8)p[(row*cBoardSize+col)/2];
+         ChessPiece piece = nibbleToPiece((col & 1) ? (b>>4) : (b & 0x0F));
+         if(piece.type()==ptNone)
+         {
+            ++nEmpty;
+            continue;
+         }
+         if(nEmpty) fen.push_back('0'+nEmpty);
+         nEmpty = 0;
+         fen.push_back(piece.toChar());
+      }
+      if(nEmpty) fen.push_back('0'+nEmpty);
+   }
+   p += cBoardBytes;
+   //
+   quint32 tailLength = 0;
+   if(!readVarUint(p, end, tailLength)) return false;
+   if(tailLength>cMaxFenTailLength || (quint32)(end-p)<tailLength) return false;
+   fen.push_back(' ');
+   fen.append(p, tailLength);
+   p += tailLength;
+   //
+   position = ChessPosition::fromString(fen);
+   return !position.isEmpty();
+}
+
+void writeRecord(QByteArray& out, const QByteArray& data)
+{
+   writeVarUint(out, data.size());
+   out.append(data);
+   writeUint16(out, qChecksum(data.constData(), data.size()));
+}
+
+bool readRecord(const char *&p, const char *end, const char *&data, quint32& size)
+{
+   if(!readVarUint(p, end, size)) return false;
+   if((quint32)(end-p)<size) return false;
+   data = p;
+   p += size;
+   //
+   quint16 checksum = 0;
+   if(!readUint16(p, end, checksum)) return false;
+   return checksum==qChecksum(data, size);
+}
+
+}
@@ -0,0 +1,36 @@
+#ifndef __BinaryGameFormat_h
+#define __BinaryGameFormat_h
+
+#include "ChessMove.h"
+#include "ChessPosition.h"
+
+#include <QByteArray>
+
+// building blocks of the binary game/session files:
+//    moves are packed into 16 bits (from:6 | to:6 | promotion:3),
+//    unsigned integers are written as little-endian base-128 varints,
+//    positions are written as a single byte for the standard initial
+//    position, otherwise as 64 4-bit cells followed by the rest of FEN
+
+namespace BinaryGameFormat
+{
+
+quint16 packMove(const ChessMove& move);
+ChessMove unpackMove(quint16 packed);
+
+void writeUint16(QByteArray& out, quint16 value);
+bool readUint16(const char *&p, const char *end, quint16& value);
+
+void writeVarUint(QByteArray& out, quint32 value);
+bool readVarUint(const char *&p, const char *end, quint32& value);
+
+void writePosition(QByteArray& out, const ChessPosition& position);
+bool readPosition(const char *&p, const char *end, ChessPosition& position);
+
+// a record is the varint length of data, data itself and its checksum
+void writeRecord(QByteArray& out, const QByteArray& data);
+bool readRecord(const char *&p, const char *end, const char *&data, quint32& size);
+
+}
+
+#endif
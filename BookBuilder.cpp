@@ -0,0 +1,433 @@
+#include "BookBuilder.h"
+#include "PolyglotBook.h"
+#include "PgnDatabase.h"
+#include "PgnImporter.h"
+#include "ChessRules.h"
+
+#include <QThread>
+#include <QTime>
+#include <QTemporaryFile>
+#include <QDir>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <queue>
+#include <string.h>
+
+namespace
+{
+
+const unsigned cDefaultMaxPly = 30;
+const unsigned cDefaultMemoryLimit = 1<<20; // records (24 Mb)
+const unsigned cMaxThreads = 16;
+const unsigned cReadBufferRecords = 4096;   // per run while merging
+const quint32 cMaxPolyglotWeight = 0xFFFF;
+
+enum GameResultCode { resultUnknown, resultWhiteWins, resultDraw, resultBlackWins };
+
+GameResultCode resultCode(const QString& result)
+{
+   if(result=="1-0") return resultWhiteWins;
+   if(result=="0-1") return resultBlackWins;
+   if(result=="1/2-1/2") return resultDraw;
+   return resultUnknown;
+}
+
+quint32 moveWeight(GameResultCode result, PieceColor side)
+{
+   switch(result)
+   {
+      case resultWhiteWins: return side==pcWhite ? 2 : 0;
+      case resultBlackWins: return side==pcBlack ? 2 : 0;
+      case resultDraw:      return 1;
+      default:              return 0;
+   }
+}
+
+// parses a range of games and spills their records in sorted runs
+class BookWorker : public QThread
+{
+public:
+   BookWorker(const PgnDatabase& database, unsigned first, unsigned last,
+              unsigned maxPly, unsigned memoryLimit) :
+      database_(database), first_(first), last_(last),
+      maxPly_(maxPly), memoryLimit_(memoryLimit), nErrors_(0), failed_(false) {}
+
+   void run()
+   {
+      std::vector<BookBuilder::Record> records;
+      records.reserve(memoryLimit_);
+      //
+      BookBuilder::Record r;
+      memset(&r, 0, sizeof(r));
+      r.games = 1;
+      //
+      GameSessionInfo info;
+      for(unsigned i=first_; i<last_ && !failed_; ++i)
+      {
+         QByteArray text = database_.gameText(i);
+         if(!PgnImporter::parseGame(text.constData(), text.constData()+text.size(), info))
+         {
+            ++nErrors_;
+            if(info.initialPosition.isEmpty()) continue;
+         }
+         //
+         GameResultCode result = resultCode(database_.entry(i).result);
+         ChessPosition position = info.initialPosition;
+         unsigned nPlies = qMin((unsigned)info.moves.size(), maxPly_);
+         for(unsigned ply=0; ply<nPlies; ++ply)
+         {
+            const ChessMove& move = info.moves[ply];
+            r.key = PolyglotBook::positionKey(position);
+            r.move = PolyglotBook::encodeMove(position, move);
+            r.weight = moveWeight(result, position.sideToMove());
+            records.push_back(r);
+            g_chessRules.applyMove(position, move);
+         }
+         //
+         if(records.size()+maxPly_>memoryLimit_) spill(records);
+      }
+      //
+      if(!records.empty()) spill(records);
+   }
+
+   std::vector<QTemporaryFile *>& runs() { return runs_; }
+   unsigned nErrors() const { return nErrors_; }
+   bool failed() const { return failed_; }
+
+private:
+   void spill(std::vector<BookBuilder::Record>& records)
+   {
+      QTemporaryFile *run = BookBuilder::spillRun(records);
+      if(run)
+         runs_.push_back(run);
+      else
+         failed_ = true;
+   }
+
+private:
+   const PgnDatabase& database_;
+   unsigned first_;
+   unsigned last_;
+   unsigned maxPly_;
+   unsigned memoryLimit_;
+   unsigned nErrors_;
+   bool failed_;
+   std::vector<QTemporaryFile *> runs_;
+};
+
+// buffered sequential reader of a run file
+class RunReader
+{
+public:
+   RunReader(QFile *file) : file_(file), pos_(0)
+   {
+      file_->seek(0);
+      buffer_.reserve(cReadBufferRecords);
+      fill();
+   }
+
+   bool atEnd() const { return pos_>=buffer_.size(); }
+   const BookBuilder::Record& current() const { return buffer_[pos_]; }
+
+   void next()
+   {
+      if(++pos_>=buffer_.size()) fill();
+   }
+
+private:
+   void fill()
+   {
+      buffer_.resize(cReadBufferRecords);
+      qint64 n = file_->read((char *)&buffer_[0], cReadBufferRecords*sizeof(BookBuilder::Record));
+      buffer_.resize(n>0 ? n/sizeof(BookBuilder::Record) : 0);
+      pos_ = 0;
+   }
+
+private:
+   QFile *file_;
+   std::vector<BookBuilder::Record> buffer_;
+   unsigned pos_;
+};
+
+bool heavierFirst(const BookBuilder::Record& a, const BookBuilder::Record& b)
+{
+   return a.weight>b.weight;
+}
+
+// priority queue item, the smallest record comes first
+struct MergeItem
+{
+   BookBuilder::Record record;
+   unsigned run;
+   //
+   bool operator<(const MergeItem& item) const
+   {
+      return item.record<record;
+   }
+};
+
+}
+
+BookBuilder::BookBuilder() :
+   maxPly_(cDefaultMaxPly), minGames_(1), nThreads_(0), memoryLimit_(cDefaultMemoryLimit)
+{
+}
+
+BookBuilder::~BookBuilder()
+{
+   reset();
+}
+
+void BookBuilder::setMaxPly(unsigned value)
+{
+   maxPly_ = value;
+}
+
+void BookBuilder::setMinGames(unsigned value)
+{
+   minGames_ = value;
+}
+
+void BookBuilder::setThreadCount(unsigned value)
+{
+   nThreads_ = value;
+}
+
+void BookBuilder::setMemoryLimit(unsigned value)
+{
+   memoryLimit_ = value;
+}
+
+const BookBuildStats& BookBuilder::stats() const
+{
+   return stats_;
+}
+
+void BookBuilder::reset()
+{
+   for(unsigned i=0; i<runs_.size(); ++i) delete runs_[i]; // removes the file
+   runs_.clear();
+   stats_ = BookBuildStats();
+}
+
+QTemporaryFile *BookBuilder::spillRun(std::vector<Record>& records)
+{
+   std::sort(records.begin(), records.end());
+   //
+   // the same opening moves repeat a lot, so runs shrink considerably
+   unsigned n = 0;
+   for(unsigned i=0; i<records.size(); ++i)
+   {
+      if(n>0 && records[n-1].key==records[i].key && records[n-1].move==records[i].move)
+      {
+         records[n-1].weight += records[i].weight;
+         records[n-1].games += records[i].games;
+         continue;
+      }
+      records[n++] = records[i];
+   }
+   //
+   QTemporaryFile *file = new QTemporaryFile(QDir::tempPath() + "/k3book");
+   qint64 size = (qint64)n*sizeof(Record);
+   if(!file->open() || (n>0 && file->write((const char *)&records[0], size)!=size))
+   {
+      delete file;
+      file = 0;
+   }
+   //
+   records.clear();
+   return file;
+}
+
+bool BookBuilder::addFile(const QString& pgnFileName)
+{
+   assert(PolyglotBook::keysLoaded());
+   //
+   QTime timer;
+   timer.start();
+   //
+   PgnDatabase database;
+   if(!database.open(pgnFileName)) return false;
+   //
+   unsigned nGames = database.gameCount();
+   unsigned nThreads = nThreads_ ? nThreads_ : (unsigned)qMax(QThread::idealThreadCount(), 1);
+   nThreads = qMin(qMin(nThreads, cMaxThreads), qMax(nGames, 1u));
+   unsigned memoryLimit = qMax(memoryLimit_/nThreads, maxPly_*16);
+   //
+   std::vector<BookWorker *> workers;
+   for(unsigned i=0; i<nThreads; ++i)
+   {
+      workers.push_back(new BookWorker(database, nGames*i/nThreads, nGames*(i+1)/nThreads,
+                                       maxPly_, memoryLimit));
+   }
+   //
+   if(nThreads==1)
+   {
+      workers[0]->run();
+   }
+   else
+   {
+      for(unsigned i=0; i<nThreads; ++i) workers[i]->start();
+      for(unsigned i=0; i<nThreads; ++i) workers[i]->wait();
+   }
+   //
+   bool ok = true;
+   for(unsigned i=0; i<nThreads; ++i)
+   {
+      std::vector<QTemporaryFile *>& runs = workers[i]->runs();
+      runs_.insert(runs_.end(), runs.begin(), runs.end());
+      stats_.nErrors += workers[i]->nErrors();
+      ok = ok && !workers[i]->failed();
+      delete workers[i];
+   }
+   //
+   stats_.nGames += nGames;
+   stats_.nRuns = runs_.size();
+   stats_.elapsedTime += timer.elapsed();
+   return ok;
+}
+
+bool BookBuilder::writeBook(const QString& bookFileName)
+{
+   QTime timer;
+   timer.start();
+   //
+   QFile book(bookFileName);
+   if(!book.open(QIODevice::WriteOnly|QIODevice::Truncate)) return false;
+   //
+   std::vector<RunReader> readers;
+   readers.reserve(runs_.size());
+   std::priority_queue<MergeItem> queue;
+   for(unsigned i=0; i<runs_.size(); ++i)
+   {
+      readers.push_back(RunReader(runs_[i]));
+      if(readers[i].atEnd()) continue;
+      MergeItem item = { readers[i].current(), i };
+      queue.push(item);
+   }
+   //
+   stats_.nPositions = 0;
+   stats_.nEntries = 0;
+   //
+   // entries of the current position, written when the next position begins
+   std::vector<Record> position;
+   QByteArray out;
+   out.reserve(cReadBufferRecords*PolyglotBook::cEntrySize);
+   bool ok = true;
+   //
+   while(ok)
+   {
+      bool done = queue.empty();
+      Record r;
+      if(!done)
+      {
+         MergeItem item = queue.top();
+         queue.pop();
+         r = item.record;
+         readers[item.run].next();
+         if(!readers[item.run].atEnd())
+         {
+            item.record = readers[item.run].current();
+            queue.push(item);
+         }
+         //
+         if(!position.empty() && position.back().key==r.key && position.back().move==r.move)
+         {
+            position.back().weight += r.weight;
+            position.back().games += r.games;
+            continue;
+         }
+         if(position.empty() || position.back().key==r.key)
+         {
+            position.push_back(r);
+            continue;
+         }
+      }
+      //
+      // position is complete: drop rare moves, scale weights to 16 bits,
+      // best moves go first as in books made by Polyglot
+      std::stable_sort(position.begin(), position.end(), heavierFirst);
+      quint32 maxWeight = 0;
+      for(unsigned i=0; i<position.size(); ++i)
+      {
+         if(position[i].games>=minGames_) maxWeight = qMax(maxWeight, position[i].weight);
+      }
+      unsigned nWritten = 0;
+      for(unsigned i=0; i<position.size(); ++i)
+      {
+         if(position[i].games<minGames_) continue;
+         //
+         PolyglotBookEntry entry;
+         entry.key = position[i].key;
+         entry.move = position[i].move;
+         entry.weight = maxWeight>cMaxPolyglotWeight ?
+                  (quint64)position[i].weight*cMaxPolyglotWeight/maxWeight : position[i].weight;
+         entry.learn = 0;
+         //
+         uchar buf[PolyglotBook::cEntrySize];
+         PolyglotBook::writeEntry(buf, entry);
+         out.append((const char *)buf, sizeof(buf));
+         ++nWritten;
+      }
+      if(nWritten)
+      {
+         ++stats_.nPositions;
+         stats_.nEntries += nWritten;
+      }
+      //
+      if(done || out.size()>=(int)(cReadBufferRecords*PolyglotBook::cEntrySize))
+      {
+         ok = book.write(out)==out.size();
+         out.clear();
+      }
+      if(done) break;
+      //
+      position.clear();
+      position.push_back(r);
+   }
+   //
+   book.close();
+   if(!ok) book.remove();
+   //
+   stats_.elapsedTime += timer.elapsed();
+   for(unsigned i=0; i<runs_.size(); ++i) delete runs_[i];
+   runs_.clear();
+   return ok;
+}
+
+BookBuildThread::BookBuildThread(const QStringList& pgnFileNames, const QString& bookFileName) :
+   pgnFileNames_(pgnFileNames), bookFileName_(bookFileName), ok_(false)
+{
+}
+
+bool BookBuildThread::ok() const
+{
+   return ok_;
+}
+
+const BookBuildStats& BookBuildThread::stats() const
+{
+   return stats_;
+}
+
+void BookBuildThread::run()
+{
+   BookBuilder builder;
+   for(int i=0; i<pgnFileNames_.size(); ++i)
+   {
+      emit readingFile(pgnFileNames_[i]);
+      if(!builder.addFile(pgnFileNames_[i]) && i==0) return;
+   }
+   stats_ = builder.stats();
+   if(stats_.nGames==0) return;
+   //
+   emit writingBook(bookFileName_);
+   QDir().mkpath(QFileInfo(bookFileName_).path());
+   QString tempFileName = bookFileName_ + ".tmp";
+   if(!builder.writeBook(tempFileName)) return;
+   stats_ = builder.stats();
+   //
+   QFile::remove(bookFileName_);
+   ok_ = QFile::rename(tempFileName, bookFileName_);
+}
@@ -0,0 +1,113 @@
+#ifndef __BookBuilder_h
+#define __BookBuilder_h
+
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QtGlobal>
+
+#include <vector>
+
+class QTemporaryFile;
+
+struct BookBuildStats
+{
+   unsigned nGames;      // games read from PGN files
+   unsigned nErrors;     // games with an illegal or unreadable move (used up to that move)
+   unsigned nPositions;  // distinct positions written to the book
+   unsigned nEntries;    // book entries (position and move)
+   unsigned nRuns;       // sorted runs spilled to temporary files
+   int elapsedTime;      // ms
+   //
+   BookBuildStats() : nGames(0), nErrors(0), nPositions(0), nEntries(0),
+      nRuns(0), elapsedTime(0) {}
+};
+
+// BookBuilder makes Polyglot opening books out of PGN files:
+// games are parsed and replayed with ChessRules in worker threads, every
+// move of the opening stage becomes a (position key, move, weight) record;
+// records are sorted in memory-bounded chunks which are spilled to
+// temporary files, then the sorted runs are merged into the book file
+// (so the whole set of records never has to fit in memory)
+//
+// move weights follow Polyglot: 2 points for a win, 1 for a draw,
+// 0 for a loss of the side which played the move
+// @@note: Polyglot keys must be loaded (see PolyglotBook::loadKeys())
+
+class BookBuilder
+{
+public:
+   BookBuilder();
+   ~BookBuilder();
+
+   void setMaxPly(unsigned value);       // only the first moves of each game are used
+   void setMinGames(unsigned value);     // moves played in fewer games are dropped
+   void setThreadCount(unsigned value);  // 0 means one thread per CPU core
+   void setMemoryLimit(unsigned value);  // maximum number of records kept in memory
+
+   bool addFile(const QString& pgnFileName);       // can be called for several files
+   bool writeBook(const QString& bookFileName);    // merges everything added so far
+
+   const BookBuildStats& stats() const;
+
+   struct Record
+   {
+      quint64 key;
+      quint16 move;    // Polyglot encoding
+      quint16 reserved;
+      quint32 weight;
+      quint32 games;
+      quint32 reserved2;
+      //
+      bool operator<(const Record& r) const
+      {
+         return key!=r.key ? key<r.key : move<r.move;
+      }
+   };
+
+   // sorts records and merges duplicates, then writes them as a run file
+   static QTemporaryFile *spillRun(std::vector<Record>& records);
+
+private:
+   void reset();
+
+private:
+   unsigned maxPly_;
+   unsigned minGames_;
+   unsigned nThreads_;
+   unsigned memoryLimit_;
+   std::vector<QTemporaryFile *> runs_;
+   BookBuildStats stats_;
+};
+
+// BookBuildThread runs a whole build (all PGN files, then the book file)
+// off the GUI thread and reports each stage by signal; the book is written
+// to a temporary file which replaces the old book only when it is complete,
+// so sessions reading the old book are not disturbed
+
+class BookBuildThread : public QThread
+{
+   Q_OBJECT
+
+public:
+   // the first PGN file must be readable, the others may not exist yet
+   BookBuildThread(const QStringList& pgnFileNames, const QString& bookFileName);
+
+   bool ok() const;
+   const BookBuildStats& stats() const;
+
+signals:
+   void readingFile(const QString& pgnFileName);
+   void writingBook(const QString& bookFileName);
+
+protected:
+   void run();
+
+private:
+   QStringList pgnFileNames_;
+   QString bookFileName_;
+   bool ok_;
+   BookBuildStats stats_;
+};
+
+#endif
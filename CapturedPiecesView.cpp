@@ -1,4 +1,6 @@
 #include "CapturedPiecesView.h"
+#include "RepaintScheduler.h"
+#include "PieceSpriteCache.h"
 
 #include <QPaintEvent>
 #include <QPainter>
@@ -15,6 +17,7 @@ CapturedPiecesView::CapturedPiecesView(QWidget *parent) :
    whiteCaptPieces_(ptPawn-ptQueen+1),
    blackCaptPieces_(ptPawn-ptQueen+1),
    linePen_(cDefaultLinePenColor),
+   pieceSize_(0),
    numberFont_("Sans", 9)
 {
 }
@@ -40,15 +43,15 @@ void CapturedPiecesView::updateContents(
    //
    if(whiteChanged && blackChanged)
    {
-      repaint();
+      g_repaintScheduler.schedule(this);
    }
    else if(whiteChanged)
    {
-      repaint(whiteRect_);
+      g_repaintScheduler.schedule(this, whiteRect_);
    }
    else if(blackChanged)
    {
-      repaint(blackRect_);
+      g_repaintScheduler.schedule(this, blackRect_);
    }
 }
 
@@ -102,7 +105,6 @@ void CapturedPiecesView::drawPieces(QPainter& painter, const QRect& rect,
    QFontMetrics fm(numberFont_);
    QSize sz(fm.width("8"), fm.height());
    QRect r(rect.left(), rect.top(), (rect.width())/5, rect.height());
-   const std::vector<QImage>& images = color==pcWhite ? whitePieces_ : blackPieces_;
    for(unsigned i=0; i<=(ptPawn-ptQueen); ++i)
    {
       int ncap = captured[i];
@@ -111,8 +113,8 @@ void CapturedPiecesView::drawPieces(QPainter& painter, const QRect& rect,
       {
          QPoint p(r.left()+r.width()/6, r.top()+r.height()/6);
          //painter.drawText(p.x(), p.y()+12, QString::number(i));
-         const QImage& pieceImage = images[i];
-         painter.drawImage(p, pieceImage);
+         ChessPiece piece((i+ptQueen)|color);
+         painter.drawImage(p, pieces_, PieceSpriteCache::spriteRect(pieceSize_, piece, false));
 
          if(ncap>1)
          {
@@ -144,26 +146,13 @@ void CapturedPiecesView::resizeImages(int size)
 {
    /*numberFont_.setPixelSize(size*2/5);*/
    //
-   QImage resizedPieces = originalPieces_.scaledToHeight(
-            size*4, Qt::SmoothTransformation);
-   //
-   whitePieces_.clear();
-   whitePieces_.reserve(ptPawn-ptQueen+1);
-   //
-   blackPieces_.clear();
-   blackPieces_.reserve(ptPawn-ptQueen+1);
-   //
-   for(int i=0; i<=(ptPawn-ptQueen); ++i)
-   {
-      int x1 = (i+ptQueen)*size;
-      whitePieces_.push_back(resizedPieces.copy(x1, 0, size, size));
-      blackPieces_.push_back(resizedPieces.copy(x1, size, size, size));
-   }
+   pieceSize_ = size;
+   pieces_ = g_pieceSprites.atlas(piecesStyle_, size);
 }
 
-void CapturedPiecesView::setPiecesImage(const QImage &image)
+void CapturedPiecesView::setPiecesStyle(const QString &imageFile)
 {
-   originalPieces_ = image;
+   piecesStyle_ = imageFile;
    updateLayout();
 }
 
@@ -183,35 +172,21 @@ void CapturedPiecesView::updateLayout()
    int imgSize = s*4/5;
    resizeImages(imgSize);
    //
-   repaint();
+   g_repaintScheduler.schedule(this);
 }
 
 void CapturedPiecesView::countFromPosition(const ChessPosition &position, int sign)
 {
-   ChessCoord coord;
-   //
-   for(coord.row=1;coord.row<=position.maxRow();++coord.row)
+   // piece counts are kept up to date by ChessPosition, no board scan needed
+   for(PieceType type=ptQueen;type<=ptPawn;++type)
    {
-      for(coord.col=1;coord.col<=position.maxCol();++coord.col)
-      {
-         ChessPiece piece = position.cell(coord);
-         if(piece.type()>=ptQueen)
-         {
-            if(piece.color()==pcWhite)
-            {
-               whiteCaptPieces_[piece.type()-ptQueen] += sign;
-            }
-            else
-            {
-               blackCaptPieces_[piece.type()-ptQueen] += sign;
-            }
-         }
-      }
+      whiteCaptPieces_[type-ptQueen] += sign*(int)position.pieceCount(pcWhite, type);
+      blackCaptPieces_[type-ptQueen] += sign*(int)position.pieceCount(pcBlack, type);
    }
 }
 
 void CapturedPiecesView::setNumberFont(const QFont& font)
 {
    numberFont_ = font;
-   repaint();
+   g_repaintScheduler.schedule(this);
 }
@@ -15,7 +15,7 @@ class CapturedPiecesView : public QWidget
 public:
    explicit CapturedPiecesView(QWidget *parent=0);
 
-   void setPiecesImage(const QImage& image);
+   void setPiecesStyle(const QString& imageFile);
    void updateContents(const ChessPosition& initialPosition,
                        const ChessPosition& currentPosition);
    void setNumberFont(const QFont& font);
@@ -40,9 +40,9 @@ private:
    QRect whiteRect_;
    QRect blackRect_;
    QPen linePen_;
-   QImage originalPieces_;
-   std::vector<QImage> whitePieces_;
-   std::vector<QImage> blackPieces_;
+   QString piecesStyle_; // pieces image file
+   QImage pieces_;       // scaled to pieceSize_, shared by PieceSpriteCache
+   int pieceSize_;
    QFont numberFont_;
 };
 
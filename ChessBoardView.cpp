@@ -1,4 +1,6 @@
 #include "ChessBoardView.h"
+#include "RepaintScheduler.h"
+#include "PieceSpriteCache.h"
 #include "MoveSelectionHelper.h"
 #include "Settings.h"
 
@@ -35,7 +37,9 @@ ChessBoardView::ChessBoardView(QWidget *parent) :
    keyPieceSelect_(false),
    quickSingleMoveSelection_(false),
    directCoordinateInput_(false),
-   lastKeyType_(ktOther)
+   lastKeyType_(ktOther),
+   pieceSize_(0),
+   boardImageValid_(false)
 {
    setMinimumSize(128, 128);
    setMaximumSize(2048, 2048);
@@ -65,23 +69,8 @@ void ChessBoardView::initGraphicObjects()
 
 void ChessBoardView::updateScaledPieces()
 {
-   scaledPieces_.clear();
-   scaledPieces_.reserve(2*2*7);
-   //
-   int newPieceSize = (width()-padding_*2)/position_.maxRow();
-   QImage pieces = originalPieces_.scaled(newPieceSize * 7, newPieceSize * 4, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-   //
-   for(unsigned cc=0; cc<=1; ++cc)
-   {
-      for(unsigned pc=0; pc<=1; ++pc)
-      {
-         for(PieceType pt=ptNone; pt<=ptPawn; ++pt)
-         {
-            QRect pieceRect(pt*newPieceSize, (pc+2*cc)*newPieceSize, newPieceSize, newPieceSize);
-            scaledPieces_.push_back(pieces.copy(pieceRect));
-         }
-      }
-   }
+   pieceSize_ = (width()-padding_*2)/position_.maxRow();
+   pieces_ = g_pieceSprites.atlas(piecesStyle_, pieceSize_);
 }
 
 int ChessBoardView::padding() const
@@ -93,17 +82,68 @@ void ChessBoardView::updatePosition(const ChessPosition& position, // updates po
                                     const CoordPair& lastMove,
                                     const ChessMoveMap& possibleMoves)
 {
-   int oldmaxCol = position_.maxCol();
+   if(position.maxCol()!=position_.maxCol() || position.maxRow()!=position_.maxRow())
+   {
+      position_ = position;
+      lastMove_ = lastMove;
+      possibleMoves_ = possibleMoves;
+      //
+      pieces_ = QImage(); // scaled to the new cell size on next paint
+      invalidateBoardImage();
+      g_repaintScheduler.schedule(this, rect());
+      return;
+   }
+   //
+   // only cells that differ between the positions are redrawn,
+   // together with the old and the new move arrow and move hints
+   QRegion dirtyRegion;
+   //
+   ChessCoord coord;
+   for(coord.row=1; coord.row<=position.maxRow(); ++coord.row)
+   {
+      for(coord.col=1; coord.col<=position.maxCol(); ++coord.col)
+      {
+         if(position.cell(coord)==position_.cell(coord)) continue;
+         invalidateCell(coord);
+         dirtyRegion += getCellRect(coord);
+      }
+   }
+   //
+   if(drawMoveArrow_ && !(lastMove==lastMove_))
+   {
+      dirtyRegion += moveArrowRegion(lastMove_);
+      dirtyRegion += moveArrowRegion(lastMove);
+   }
+   //
+   bool hintsShown = showMoveHints_ && cellSelectMode_==selectTarget;
+   if(hintsShown) dirtyRegion += moveHintsRegion(move_.from);
+   //
    position_ = position;
    lastMove_ = lastMove;
    possibleMoves_ = possibleMoves;
    //
-   if(position_.maxCol()!=oldmaxCol)
+   if(hintsShown) dirtyRegion += moveHintsRegion(move_.from);
+   //
+   if(!dirtyRegion.isEmpty()) g_repaintScheduler.schedule(this, dirtyRegion);
+}
+
+QRegion ChessBoardView::moveArrowRegion(const CoordPair& move) const
+{
+   if(move.from==move.to) return QRegion();
+   //
+   // the arrow stays within the rect spanned by both cells
+   return QRegion(getMoveRect(move));
+}
+
+QRegion ChessBoardView::moveHintsRegion(ChessCoord from) const
+{
+   QRegion region;
+   ChessMoveMap::const_iterator_pair range = possibleMoves_.getMovesFrom(from);
+   for(;range.first!=range.second;++range.first)
    {
-      updateScaledPieces();
+      region += getCellRect(range.first->to);
    }
-   //
-   repaint(rect());
+   return region;
 }
 
 bool ChessBoardView::enter()
@@ -153,21 +193,23 @@ void ChessBoardView::beginMoveSelection()
       move_.to = move_.from;
    }
    //
-   repaint(repaintRect.united(getMoveRect(move_)));
+   g_repaintScheduler.schedule(this, repaintRect.united(getMoveRect(move_)));
 }
 
 void ChessBoardView::setFlipped(bool value)
 {
    if(flipped_==value) return;
    flipped_ = value;
-   repaint(rect());
+   invalidateBoardImage();
+   g_repaintScheduler.schedule(this, rect());
 }
 
 void ChessBoardView::setPadding(unsigned value)
 {
    if(padding_==value) return;
    padding_ = value;
-   repaint(rect());
+   invalidateBoardImage();
+   g_repaintScheduler.schedule(this, rect());
 }
 
 QRect ChessBoardView::getMoveRect(const CoordPair& move) const
@@ -259,7 +301,7 @@ void ChessBoardView::columnSelect(int col)
       }
    }
    //
-   repaint(repaintRect.united(getCellRect(move_.to)));
+   g_repaintScheduler.schedule(this, repaintRect.united(getCellRect(move_.to)));
 }
 
 void ChessBoardView::rowSelect(int row)
@@ -295,7 +337,7 @@ void ChessBoardView::rowSelect(int row)
       }
    }
    //
-   repaint(repaintRect.united(getCellRect(move_.to)));
+   g_repaintScheduler.schedule(this, repaintRect.united(getCellRect(move_.to)));
 }
 
 void ChessBoardView::pieceSelect(PieceType pt)
@@ -325,7 +367,7 @@ void ChessBoardView::pieceSelect(PieceType pt)
       }
    }
    //
-   repaint(repaintRect.united(getCellRect(move_.to)));
+   g_repaintScheduler.schedule(this, repaintRect.united(getCellRect(move_.to)));
 }
 
 bool ChessBoardView::checkColumnSelectionKey(Qt::Key key)
@@ -464,7 +506,7 @@ bool ChessBoardView::processDirectCoordinateSource(Qt::Key key)
          if(expectDirectColKey(key, move_.from))
          {
             QRect fromBaseRect = getBaseRect(move_.from.col);
-            repaint(fromBaseRect);
+            g_repaintScheduler.schedule(this, fromBaseRect);
          }
          else
          {
@@ -496,22 +538,22 @@ bool ChessBoardView::processDirectCoordinateSource(Qt::Key key)
                   //
                   if(showMoveHints_)
                   {
-                     repaint(boardCellsRect());
+                     g_repaintScheduler.schedule(this, boardCellsRect());
                   }
                   else
                   {
-                     repaint(getCellRect(move_.from).united(oldFromBaseRect));
+                     g_repaintScheduler.schedule(this, getCellRect(move_.from).united(oldFromBaseRect));
                   }
                }
                else
                {
-                  repaint(oldFromBaseRect);
+                  g_repaintScheduler.schedule(this, oldFromBaseRect);
                }
             }
             else
             {
                lastKeyType_ = ktOther;
-               repaint(oldFromBaseRect);
+               g_repaintScheduler.schedule(this, oldFromBaseRect);
             }
          }
          break;
@@ -519,7 +561,7 @@ bool ChessBoardView::processDirectCoordinateSource(Qt::Key key)
          {
             QRect fromBaseRect = getBaseRect(move_.from.col);
             lastKeyType_ = ktOther;
-            repaint(fromBaseRect);
+            g_repaintScheduler.schedule(this, fromBaseRect);
          }
          return false;
    }
@@ -535,7 +577,7 @@ bool ChessBoardView::processDirectCoordinateTarget(Qt::Key key)
          if(expectDirectColKey(key, move_.to))
          {
             QRect toBaseRect = getBaseRect(move_.to.col);
-            repaint(toBaseRect);
+            g_repaintScheduler.schedule(this, toBaseRect);
          }
          else
             return false;
@@ -555,7 +597,7 @@ bool ChessBoardView::processDirectCoordinateTarget(Qt::Key key)
                {
                   cellSelectMode_ = selectSource;
                   lastKeyType_ = ktOther;
-                  repaint(getCellRect(move_.from).united(oldToBaseRect));
+                  g_repaintScheduler.schedule(this, getCellRect(move_.from).united(oldToBaseRect));
                }
             }
             else
@@ -566,7 +608,7 @@ bool ChessBoardView::processDirectCoordinateTarget(Qt::Key key)
          {
             QRect oldToBaseRect = getBaseRect(move_.to.col);
             lastKeyType_ = ktOther;
-            repaint(getCellRect(move_.from).united(oldToBaseRect));
+            g_repaintScheduler.schedule(this, getCellRect(move_.from).united(oldToBaseRect));
             break;
          }
          return false;
@@ -642,7 +684,7 @@ void ChessBoardView::mousePressEvent(QMouseEvent *event)
       if(cellSelectMode_==selectTarget)
       {
          move_.to = move_.from;
-         repaint(moveRect);
+         g_repaintScheduler.schedule(this, moveRect);
          //
          select();
       }
@@ -654,11 +696,11 @@ void ChessBoardView::mousePressEvent(QMouseEvent *event)
          case selectSource:
             move_.from = coord;
             move_.to = coord;
-            repaint(moveRect.united(getMoveRect(move_)));
+            g_repaintScheduler.schedule(this, moveRect.united(getMoveRect(move_)));
             break;
          case selectTarget:
             move_.to = coord;
-            repaint(moveRect.united(getMoveRect(move_)));
+            g_repaintScheduler.schedule(this, moveRect.united(getMoveRect(move_)));
             break;
          default:
             return;
@@ -670,20 +712,79 @@ void ChessBoardView::mousePressEvent(QMouseEvent *event)
 
 void ChessBoardView::paintEvent(QPaintEvent *event)
 {
-   QPixmap pix(size());
-   QPainter buffer(&pix);
-   //
-   buffer.setClipRect(event->rect());
-   drawBoard(buffer, event->rect());
-   drawBorder(buffer, event->rect());
+   updateBoardImage();
    //
+   // only the damaged region is copied from the board image,
+   // cursor and other overlays are drawn over it
    QPainter painter(this);
-   painter.drawPixmap(QPoint(0, 0), pix);
+   painter.setClipRect(event->rect());
+   painter.drawPixmap(event->rect().topLeft(), boardImage_, event->rect());
+   drawOverlays(painter, event->rect());
+   //
+   static bool firstPaint = true;
+   if(firstPaint)
+   {
+      firstPaint = false;
+      Singletons::logStartupPhase("first board");
+   }
 }
 
 void ChessBoardView::resizeEvent(QResizeEvent *)
 {
-   scaledPieces_.clear(); // will be updated on next paint
+   pieces_ = QImage(); // will be updated on next paint
+   invalidateBoardImage();
+}
+
+void ChessBoardView::invalidateBoardImage()
+{
+   boardImageValid_ = false;
+}
+
+void ChessBoardView::invalidateCell(ChessCoord coord)
+{
+   if(!position_.inRange(coord)) return;
+   //
+   unsigned index = (coord.row-1)*position_.maxCol() + coord.col-1;
+   if(index<dirtyCells_.size()) dirtyCells_[index] = true;
+}
+
+void ChessBoardView::updateBoardImage()
+{
+   if(pieces_.isNull())
+   {
+      updateScaledPieces();
+   }
+   //
+   if(boardImage_.size()!=size())
+   {
+      boardImage_ = QPixmap(size());
+      boardImageValid_ = false;
+   }
+   //
+   QPainter painter(&boardImage_);
+   //
+   if(!boardImageValid_)
+   {
+      painter.fillRect(rect(), borderBrush_); // cell rounding leaves a few pixels uncovered
+      drawBoard(painter, rect());
+      drawBorder(painter, rect());
+      //
+      dirtyCells_.assign(position_.maxCol()*position_.maxRow(), false);
+      boardImageValid_ = true;
+      return;
+   }
+   //
+   ChessCoord coord;
+   unsigned index = 0;
+   for(coord.row=1; coord.row<=position_.maxRow(); ++coord.row)
+   {
+      for(coord.col=1; coord.col<=position_.maxCol(); ++coord.col, ++index)
+      {
+         if(index>=dirtyCells_.size() || !dirtyCells_[index]) continue;
+         drawPiece(painter, getCellRect(coord), position_.cell(coord), (coord.row+coord.col)%2==0);
+         dirtyCells_[index] = false;
+      }
+   }
 }
 
 void ChessBoardView::drawColumnHighlight(QPainter& painter, ColValue col, const QRect& clipRect)
@@ -698,7 +799,7 @@ void ChessBoardView::drawColumnHighlight(QPainter& painter, ColValue col, const
 
 void ChessBoardView::drawBoard(QPainter& painter, const QRect& clipRect)
 {
-   if(scaledPieces_.empty())
+   if(pieces_.isNull())
    {
       updateScaledPieces();
    }
@@ -715,7 +816,10 @@ void ChessBoardView::drawBoard(QPainter& painter, const QRect& clipRect)
          drawPiece(painter, cellRect, position_.cell(coord), (coord.row+coord.col)%2==0);
       }
    }
-   //
+}
+
+void ChessBoardView::drawOverlays(QPainter& painter, const QRect& clipRect)
+{
    if(directCoordinateInput_)
    {
       switch(cellSelectMode_)
@@ -805,12 +909,9 @@ void ChessBoardView::drawMoveHints(QPainter& painter, ChessCoord& coord, const Q
 
 void ChessBoardView::drawPiece(QPainter& painter, const QRect& rect, ChessPiece piece, bool blackCell)
 {
-   unsigned index = (blackCell ? 14 : 0) + (piece.color()==pcWhite ? 0 : 7) + piece.type();
+   if(pieces_.isNull()) return;
    //
-   if(index<scaledPieces_.size())
-   {
-      painter.drawImage(rect.left(), rect.top(), scaledPieces_[index]);
-   }
+   painter.drawImage(rect.topLeft(), pieces_, PieceSpriteCache::spriteRect(pieceSize_, piece, blackCell));
 }
 
 QRect inflateRect(const QRect& rect, int d)
@@ -1023,7 +1124,7 @@ void ChessBoardView::moveCursor(CursorDirection dir)
       break;
    }
    //
-   repaint(repaintRect);
+   g_repaintScheduler.schedule(this, repaintRect);
 }
 
 void ChessBoardView::select()
@@ -1045,7 +1146,7 @@ void ChessBoardView::select()
                }
                if(showMoveHints_)
                {
-                  repaint(boardCellsRect());
+                  g_repaintScheduler.schedule(this, boardCellsRect());
                }
             }
          }
@@ -1058,7 +1159,7 @@ void ChessBoardView::select()
                //
                if(showMoveHints_)
                {
-                  repaint(boardCellsRect());
+                  g_repaintScheduler.schedule(this, boardCellsRect());
                }
             }
             else if(possibleMoves_.contains(move_))
@@ -1089,7 +1190,7 @@ bool ChessBoardView::cancel()
       cellSelectMode_ = selectSource;
       move_.from = move_.to;
       //
-      repaint(repaintRect);
+      g_repaintScheduler.schedule(this, repaintRect);
       //
       return true;
    }
@@ -1114,7 +1215,7 @@ void ChessBoardView::cancelMoveSelection()
    QRect repaintRect(getCellRect(move_.from).united(getCellRect(move_.to)));
    lastCursorPos_ = move_.to;
    cellSelectMode_ = selectNone;
-   repaint(repaintRect);
+   g_repaintScheduler.schedule(this, repaintRect);
 }
 
 bool ChessBoardView::hasCursor() const
@@ -1128,11 +1229,12 @@ void ChessBoardView::suspendSelection()
    cancelMoveSelection();
 }
 
-void ChessBoardView::setPiecesImage(const QImage& image)
+void ChessBoardView::setPiecesStyle(const QString& imageFile)
 {
-   originalPieces_ = image;
-   updateScaledPieces();
-   repaint(rect());
+   piecesStyle_ = imageFile;
+   pieces_ = QImage(); // scaled on next paint, when the view has its final size
+   invalidateBoardImage();
+   g_repaintScheduler.schedule(this, rect());
 }
 
 void ChessBoardView::setDrawCoords(bool value)
@@ -1146,23 +1248,24 @@ void ChessBoardView::setDrawCoords(bool value)
    else
       padding_ = 0;
    //
-   updateScaledPieces();
+   pieces_ = QImage(); // scaled to the new cell size on next paint
+   invalidateBoardImage();
    //
-   repaint(rect());
+   g_repaintScheduler.schedule(this, rect());
 }
 
 void ChessBoardView::setDrawMoveArrow(bool value)
 {
    if(drawMoveArrow_==value) return;
    drawMoveArrow_ = value;
-   repaint(getMoveRect(lastMove_));
+   g_repaintScheduler.schedule(this, getMoveRect(lastMove_));
 }
 
 void ChessBoardView::setShowMoveHints(bool value)
 {
    if(showMoveHints_==value) return;
    showMoveHints_ = value;
-   repaint(rect());
+   g_repaintScheduler.schedule(this, rect());
 }
 
 void ChessBoardView::setKeyCoordSelect(bool value)
@@ -1199,5 +1302,6 @@ void ChessBoardView::setBorderColor(QColor color)
 {
    if(color==borderColor()) return;
    borderBrush_.setColor(color);
-   repaint();
+   invalidateBoardImage();
+   g_repaintScheduler.schedule(this);
 }
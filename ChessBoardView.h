@@ -3,6 +3,8 @@
 
 #include <QWidget>
 #include <QImage>
+#include <QPixmap>
+#include <QRegion>
 #include <QString>
 #include <QPen>
 #include <QFont>
@@ -28,7 +30,7 @@ public:
    void setDrawCoords(bool);                // toggle coords along board sides
    void setFlipped(bool);                   // toggle board flipped display
    void setPadding(unsigned);               // sets padding around the board (note: padding is required if you want to see coordinates)
-   void setPiecesImage(const QImage& image); // sets image to be used for drawing board squares and pieces
+   void setPiecesStyle(const QString& imageFile); // sets image to be used for drawing board squares and pieces
    void setDrawMoveArrow(bool value);
    void setShowMoveHints(bool value);
    void setQuickSingleMoveSelection(bool value); // if selected piece has only one allowed move, make that move
@@ -69,6 +71,8 @@ private:
    QRect getMoveRect(const CoordPair& move) const;
    QRect getCellRect(ChessCoord coord) const;
    QRect boardCellsRect() const; // returns a rect encompassing all cells on the board (excluding the border)
+   QRegion moveArrowRegion(const CoordPair& move) const;  // area covered by the last move arrow
+   QRegion moveHintsRegion(ChessCoord from) const;        // cells marked with move hints for the piece
    QRect getBaseRect(ColValue col); // gets visible bottom cell rect for the given col
 
    ChessCoord chessCoordFromPoint(const QPoint& p) const;
@@ -78,7 +82,12 @@ private:
    void initGraphicObjects();
    void updateScaledPieces();
 
+   void invalidateBoardImage();          // board image is redrawn completely on next paint
+   void invalidateCell(ChessCoord coord); // only the cell is redrawn in the board image on next paint
+   void updateBoardImage();              // redraws invalid parts of the board image
+
    void drawBoard(QPainter& painter, const QRect& clipRect);
+   void drawOverlays(QPainter& painter, const QRect& clipRect); // cursor, highlights, arrow and hints over the board image
    void drawPiece(QPainter& painter, const QRect& rect, ChessPiece piece, bool blackCell);
    void drawCellHighlight(QPainter& painter, const QRect& rect, bool bold);
    void drawColumnHighlight(QPainter& painter, ColValue col, const QRect& clipRect);
@@ -121,7 +130,7 @@ private:
    QBrush borderBrush_;
    QFont horizCoordsFont_;
    QFont vertCoordsFont_;
-   QImage originalPieces_;
+   QString piecesStyle_;         // pieces image file
    bool drawMoveArrow_;
    bool showMoveHints_;
    bool moveSelectionSuspended_;
@@ -130,7 +139,11 @@ private:
    bool quickSingleMoveSelection_;
    bool directCoordinateInput_;
    LastKeyType lastKeyType_;
-   std::vector<QImage> scaledPieces_;
+   QImage pieces_;               // pieces image scaled to pieceSize_, shared by PieceSpriteCache
+   int pieceSize_;
+   QPixmap boardImage_;          // squares, pieces and border, kept between paint events
+   bool boardImageValid_;
+   std::vector<bool> dirtyCells_; // cells to be redrawn in the board image
 };
 
 #endif
@@ -1,24 +1,44 @@
 #include "ChessGame.h"
 #include "Settings.h"
 #include "StringUtils.h"
+#include "MoveCache.h"
 
 #include <fstream>
 
 namespace
 {
 
+const char *cLogFile = "./logs/pos_moves.log";
+
+bool logChecked = false;
+bool noLog = false;
+
+}
+
+bool loggingEnabled()
+{
+   if(!logChecked)
+   {
+      // starts a new log, will fail if there is no 'logs' folder
+      logChecked = true;
+      std::ofstream out(cLogFile, std::ios::trunc);
+      noLog = out.fail();
+   }
+   return !noLog;
+}
+
 void logString(const std::string& str)
 {
-   static unsigned nCalls = 0;
-   static bool noLog = false;
-   if(noLog) return;
-   std::ofstream out("./logs/pos_moves.log", nCalls==0 ? std::ios::trunc : std::ios::app);
+   if(!loggingEnabled()) return;
+   std::ofstream out(cLogFile, std::ios::app);
    noLog = out.fail();
-   if(noLog) return; // will fail if there is no 'logs' folder
+   if(noLog) return;
    out << str << std::endl;
-   ++nCalls;
 }
 
+namespace
+{
+
 void logIllegalMove(const ChessMove& move)
 {
    logString(std::string("Attempt to make an illegal move: ") + move.toString());
@@ -26,6 +46,8 @@ void logIllegalMove(const ChessMove& move)
 
 void logPositionAndMoves(const ChessPosition& position, const ChessMoveMap& moves)
 {
+   if(!loggingEnabled()) return;
+   //
    std::string str;
    str.reserve(200);
    str.append("Position: ");
@@ -50,6 +72,9 @@ void logPositionAndMoves(const ChessPosition& position, const ChessMoveMap& move
    }
    //
    str.append("\n");
+   str.append("Move cache: ");
+   str.append(QString("%1 hits; %2 misses").arg(g_moveCache.hits()).arg(g_moveCache.misses()).toStdString());
+   str.append("\n");
    //
    logString(str);
 }
@@ -420,17 +445,21 @@ QString getPgnScore(ChessGameResult result)
       case resultWhiteCheckmates:
       case resultBlackResigns:
       case resultWhiteWonOnTime:
+      case resultWhiteWinsByAdjudication:
          return "1-0";
          break;
       case resultBlackCheckmates:
       case resultWhiteResigns:
       case resultBlackWonOnTime:
+      case resultBlackWinsByAdjudication:
          return "0-1";
          break;
       case resultDrawnByAgreement:
       case resultDrawnByStalemate:
       case resultDrawnByRepetition:
       case resultDrawnBy50MoveRule:
+      case resultDrawnByAdjudication:
+      case resultDrawnByInsufficientMaterial:
          return "1/2-1/2";
          break;
       default:
@@ -452,6 +481,10 @@ QString getPgnResultMessage(ChessGameResult result)
    case resultDrawnByRepetition: return "Game drawn by threefold repetition";
    case resultDrawnByStalemate: return "Game drawn by stalemate";
    case resultDrawnBy50MoveRule: return "Game drawn by 50 move rule";
+   case resultWhiteWinsByAdjudication: return "White won by adjudication";
+   case resultBlackWinsByAdjudication: return "Black won by adjudication";
+   case resultDrawnByAdjudication: return "Game drawn by adjudication";
+   case resultDrawnByInsufficientMaterial: return "Game drawn by insufficient material";
    default:
       return QString();
    }
@@ -583,6 +616,12 @@ bool ChessGame::applyMove(const ChessMove& move)
       emit fiftyMovesDetected();
    }
    //
+   // material only decreases with captures (and changes with promotions)
+   if((moveType & (moveCapture|movePromotion)) && g_chessRules.isInsufficientMaterial(position_))
+   {
+      emit insufficientMaterialDetected();
+   }
+   //
    return true;
 }
 
@@ -632,7 +671,9 @@ const QString& ChessGame::lastRuMove() const
 
 void ChessGame::recalcPossibleMoves()
 {
-   g_chessRules.findPossibleMoves(position_, possibleMoves_);
+   // takebacks and moving back and forth through a game
+   // mostly revisit positions whose moves are already cached
+   g_moveCache.findPossibleMoves(position_, possibleMoves_);
    //
    logPositionAndMoves(position_, possibleMoves_);
    //
@@ -16,7 +16,14 @@ enum ChessGameResult { resultNone, // e.g. still under way, or canceled
                        resultWhiteWonOnTime, resultBlackWonOnTime,
                        resultWhiteResigns, resultBlackResigns,
                        resultDrawnByAgreement, resultDrawnByRepetition,
-                       resultDrawnByStalemate, resultDrawnBy50MoveRule };
+                       resultDrawnByStalemate, resultDrawnBy50MoveRule,
+                       resultWhiteWinsByAdjudication, resultBlackWinsByAdjudication,
+                       resultDrawnByAdjudication, resultDrawnByInsufficientMaterial };
+
+// appends a line to the position log (./logs/pos_moves.log), which is
+// written only if there is a 'logs' folder
+void logString(const std::string& str);
+bool loggingEnabled(); // check before formatting expensive log lines
 
 class ChessPlayer;
 
@@ -63,6 +70,7 @@ signals:
    void stalemateDetected();
    void repetitionDetected();
    void fiftyMovesDetected();
+   void insufficientMaterialDetected();
 
 private:
    void recalcPossibleMoves();
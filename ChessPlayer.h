@@ -43,6 +43,10 @@ public:
    virtual void opponentRequestsAbort(bool& accept);      // default behavior is reject
    virtual void gameResult(ChessGameResult result) {}     // notify player that the game was finished with the given result
                                                           // (resultNone means the game was aborted)
+   virtual bool acceptsBookMoves() const { return false; } // player allows the GUI to play opening book moves on his behalf
+   virtual void bookMovePlayed(const ChessMove& lastMove,
+                               const ChessMove& move) {}  // instead of makeMove() call, informs the player that the GUI has played
+                                                          // the given book move for him (lastMove is the preceding opponent move)
    // additional commands
    virtual bool setChess960(bool value); // must try to set mode to Chess960 if value=true, return true if supported, false otherwise, if false is passed, always return true
 
@@ -55,6 +59,9 @@ signals:
    void playerSays(const QString& msg);        // player sends a message to his opponent
    void playerRequestsTakeback();
    void playerRequestsAbort();
+   void playerRestarted();                     // player has lost track of the game (e.g. its process was restarted)
+                                               // and expects beginGame(), setInitialPosition() and replayMove() calls
+                                               // followed by makeMove() if it is his turn
 
 private:
    QString name_;
@@ -6,15 +6,20 @@
 #include "Random.h"
 
 #include <QTextCodec>
+#include <QTime>
 #include <fstream>
 
 namespace
 {
 
 const int cUciokTimeoutMs = 5000; // milliseconds to wait for 'uciok'
-const int cDefaultUciForceMoveTimeout = 3000;
+const int cUntimedUciMoveTime = 3000; // ms per move when the engine clock is untimed
 const int cEasyModeUciMoveTimeout = 1000;
 const bool cRandomizeMoveTimeout = true;
+const int cStopResponseTimeoutMs = 5000; // ms to wait for a move after 'stop' or flag fall
+const int cPingIntervalMs = 5000;        // ms between 'isready' checks while engine is thinking
+const int cPingTimeoutMs = 15000;        // ms an 'isready' may stay unanswered ('ucinewgame' may allocate hash or load networks)
+const unsigned cMaxEngineRestarts = 3;   // per game, to avoid endless restarts of a broken engine
 
 enum TalkDirection { TO_ENGINE, FROM_ENGINE, COMMENT };
 
@@ -47,14 +52,18 @@ ChessPlayer_LocalEngine::ChessPlayer_LocalEngine(const EngineInfo& info,
    ChessPlayer(info.name), info_(info), readyRequest_(false),
    engineProcess_(this), inForceMode_(false),
    profileName_(profileName.isEmpty() ? QString("Default") : profileName),
-   forceMoveTimeout_(cDefaultUciForceMoveTimeout),
+   pingPending_(false), movePending_(false), restarting_(false),
+   shuttingDown_(false), nRestarts_(0), chess960_(false), lastMoveReplayed_(false),
    randomizeMoveTimeout_(cRandomizeMoveTimeout), weakMode_(false)
 {
    //
    QObject::connect(&engineProcess_, SIGNAL(started()),
                     this, SLOT(engineStarted()), Qt::UniqueConnection);
    QObject::connect(&engineProcess_, SIGNAL(error(QProcess::ProcessError)),
-                    this, SIGNAL(engineProcessError(QProcess::ProcessError)),
+                    this, SLOT(engineError(QProcess::ProcessError)),
+                    Qt::UniqueConnection);
+   QObject::connect(&engineProcess_, SIGNAL(finished(int, QProcess::ExitStatus)),
+                    this, SLOT(engineFinished(int, QProcess::ExitStatus)),
                     Qt::UniqueConnection);
    QObject::connect(&engineProcess_, SIGNAL(readyRead()),
                     this, SLOT(engineHasOutput()), Qt::UniqueConnection);
@@ -64,13 +73,20 @@ ChessPlayer_LocalEngine::ChessPlayer_LocalEngine(const EngineInfo& info,
    if(profileName_.toLower()=="weak"||profileName_.toLower()=="easy")
    {
       weakMode_ = true;
-      forceMoveTimeout_ = cEasyModeUciMoveTimeout;
+      timeManager_.setMaxMoveTime(cEasyModeUciMoveTimeout);
    }
    //
+   timeManager_.setFixedMoveTime(cUntimedUciMoveTime);
+   //
    forceMoveTimer_.setSingleShot(true);
    forceMoveTimer_.blockSignals(true);
    QObject::connect(&forceMoveTimer_, SIGNAL(timeout()), this, SLOT(forceMoveTimeout()));
    //
+   watchdogTimer_.setSingleShot(true);
+   QObject::connect(&watchdogTimer_, SIGNAL(timeout()), this, SLOT(watchdogTimeout()));
+   pingTimer_.setSingleShot(false);
+   QObject::connect(&pingTimer_, SIGNAL(timeout()), this, SLOT(pingTimeout()));
+   //
    QString workDir = extractFolderPath(info_.exePath);
    engineProcess_.setWorkingDirectory(workDir);
    engineProcess_.start(info_.exePath);
@@ -78,6 +94,8 @@ ChessPlayer_LocalEngine::ChessPlayer_LocalEngine(const EngineInfo& info,
 
 ChessPlayer_LocalEngine::~ChessPlayer_LocalEngine()
 {
+   shuttingDown_ = true; // engine exit is expected from now on
+   stopSupervision();
    performCleanup(); // remove log etc. files of the last session
    engineProcess_.kill();
 }
@@ -97,6 +115,21 @@ void ChessPlayer_LocalEngine::getReady()
 
 void ChessPlayer_LocalEngine::engineStarted()
 {
+   if(restarting_)
+   {
+      restarting_ = false;
+      logEngineTalk(COMMENT, "Engine restarted");
+      //
+      if(info_.type!=etDetect)
+      {
+         engineTypeDetected(false);
+         if(chess960_) setChess960(true);
+         //
+         emit playerRestarted(); // game session will replay the game to us
+         return;
+      }
+   }
+   //
    if(info_.type==etDetect)
    {
       // try to detect engine type by sending the "uci" command
@@ -190,6 +223,7 @@ void ChessPlayer_LocalEngine::engineTypeDetected(bool updateEngineIni)
          break;
       case etUCI:
          setUCIPonderOption();
+         pingEngine();
          break;
       default:
          break;
@@ -221,11 +255,13 @@ void ChessPlayer_LocalEngine::beginGame(PieceColor color,
    const QString& opponentName, const ChessClock& clock)
 {
    opponentName_ = opponentName;
+   lastMoveReplayed_ = false;
    //
    switch(info_.type)
    {
       case etUCI:
          tellEngine("ucinewgame");
+         pingEngine();
          break;
       case etXBoard:
          tellEngine("new");
@@ -261,6 +297,10 @@ void ChessPlayer_LocalEngine::makeMove(const ChessPosition& position,
    {
       case etUCI:
          {
+            const ChessClock& engineClock =
+                  position.sideToMove()==pcWhite ? whiteClock : blackClock;
+            MoveTimeBudget budget = timeManager_.getBudget(engineClock, position);
+            //
             std::string cmd;
             cmd.reserve(256);
             cmd.append("position fen ");
@@ -268,14 +308,25 @@ void ChessPlayer_LocalEngine::makeMove(const ChessPosition& position,
             tellEngine(cmd);
             cmd.clear();
             cmd.append("go ");
-            cmd.append("wtime ");
-            cmd.append(uintToStr(whiteClock.remainingTime));
-            cmd.append(" btime ");
-            cmd.append(uintToStr(blackClock.remainingTime));
-            cmd.append(" winc ");
-            cmd.append(uintToStr(whiteClock.moveIncrement));
-            cmd.append(" binc ");
-            cmd.append(uintToStr(blackClock.moveIncrement));
+            if(budget.fixedMoveTime)
+            {
+               cmd.append("movetime ");
+               cmd.append(uintToStr(budget.optimumTime));
+            }
+            else
+            {
+               cmd.append("wtime ");
+               cmd.append(uintToStr(whiteClock.remainingTime));
+               cmd.append(" btime ");
+               cmd.append(uintToStr(blackClock.remainingTime));
+               cmd.append(" winc ");
+               cmd.append(uintToStr(whiteClock.moveIncrement));
+               cmd.append(" binc ");
+               cmd.append(uintToStr(blackClock.moveIncrement));
+               // no 'movestogo': it means moves until the next time control,
+               // and our clocks are never refilled (the budget only sets
+               // the force move timeout below)
+            }
             if(weakMode_)
             {
                cmd.append(" depth 5");
@@ -283,10 +334,13 @@ void ChessPlayer_LocalEngine::makeMove(const ChessPosition& position,
             tellEngine(cmd);
             //
             forceMoveTimer_.blockSignals(false);
-            int timeout = forceMoveTimeout_;
+            int timeout = budget.maximumTime;
             if(randomizeMoveTimeout_)
-               timeout += g_random.get(-timeout/3, +timeout/3);
+               timeout -= g_random.get(0, (timeout-budget.optimumTime)/3);
             forceMoveTimer_.start(timeout);
+            //
+            movePending_ = true;
+            pingTimer_.start(cPingIntervalMs);
          }
          break;
       case etXBoard:
@@ -304,11 +358,12 @@ void ChessPlayer_LocalEngine::makeMove(const ChessPosition& position,
             cmd.append(uintToStr(opponentTime/10));
             tellEngine(cmd);
             //
-            if(lastMove.assigned())
+            if(lastMove.assigned() && !lastMoveReplayed_)
             {
                tellEngine(lastMove.toString());
                //
             }
+            lastMoveReplayed_ = false;
             //
             if(inForceMode_)
             {
@@ -323,6 +378,15 @@ void ChessPlayer_LocalEngine::makeMove(const ChessPosition& position,
                }
                tellEngine("go");
             }
+            //
+            // XBoard engines manage their own time, so the only thing
+            // we can detect is an engine that outlives its clock
+            // (an untimed engine may think as long as it likes)
+            movePending_ = true;
+            const ChessClock& engineClock =
+                  position.sideToMove()==pcWhite ? whiteClock : blackClock;
+            if(!engineClock.untimed)
+               watchdogTimer_.start(engineTime + cStopResponseTimeoutMs);
          }
          break;
       case etDetect:
@@ -331,6 +395,31 @@ void ChessPlayer_LocalEngine::makeMove(const ChessPosition& position,
    }
 }
 
+bool ChessPlayer_LocalEngine::acceptsBookMoves() const
+{
+   // weak profile plays without any book
+   return !weakMode_;
+}
+
+void ChessPlayer_LocalEngine::bookMovePlayed(const ChessMove& lastMove, const ChessMove& move)
+{
+   // UCI engines get the whole position with every move request,
+   // XBoard engines must see both moves without starting to think
+   if(info_.type!=etXBoard) return;
+   //
+   if(!inForceMode_)
+   {
+      inForceMode_ = true;
+      tellEngine("force");
+   }
+   if(lastMove.assigned() && !lastMoveReplayed_)
+   {
+      tellEngine(lastMove.toString());
+   }
+   tellEngine(move.toString());
+   lastMoveReplayed_ = false;
+}
+
 void ChessPlayer_LocalEngine::opponentOffersDraw()
 {
    tellEngine("draw");
@@ -343,6 +432,9 @@ void ChessPlayer_LocalEngine::opponentAcceptsDraw()
 
 void ChessPlayer_LocalEngine::gameResult(ChessGameResult result)
 {
+   stopSupervision();
+   nRestarts_ = 0;
+   //
    switch(info_.type)
    {
       case etUCI:
@@ -381,23 +473,34 @@ void ChessPlayer_LocalEngine::processEngineResponse(const std::string& str)
          {
             forceMoveTimer_.blockSignals(true);
             forceMoveTimer_.stop();
+            stopSupervision();
             //
             size_t pos = str.find(' ', 9);
             if(pos==std::string::npos) pos = str.length();
             std::string move_str = str.substr(9, pos-9);
             emit playerMoves(move_str);
          }
+         else if(str.find("readyok")==0)
+         {
+            if(pingPending_)
+            {
+               pingPending_ = false;
+               timeManager_.addLatencySample(pingTime_.elapsed());
+            }
+         }
          /* no draw/resign options for UCI engines*/
          break;
       case etXBoard:
          if(startsWith(str, "move "))
          {
             std::string move_str = trim(str.substr(5));
+            stopSupervision();
             emit playerMoves(move_str);
          }
          else if(startsWith(str, "my move is "))
          {
             std::string move_str = trim(str.substr(11));
+            stopSupervision();
             emit playerMoves(move_str);
          }
          else if(startsWith(str, "offer draw"))
@@ -428,6 +531,12 @@ void ChessPlayer_LocalEngine::processEngineResponse(const std::string& str)
 
 void ChessPlayer_LocalEngine::engineHasOutput()
 {
+   if(restarting_)
+   {
+      engineProcess_.readAll(); // the rest of the killed engine output
+      return;
+   }
+   //
    const unsigned cBufferSize = 1024;
    char buffer[cBufferSize];
    //
@@ -576,6 +685,7 @@ void ChessPlayer_LocalEngine::replayMove(const ChessMove &move)
    {
       assert(inForceMode_);
       tellEngine(move.toString());
+      lastMoveReplayed_ = true;
    }
 }
 
@@ -586,6 +696,8 @@ const EngineInfo& ChessPlayer_LocalEngine::info() const
 
 bool ChessPlayer_LocalEngine::setChess960(bool value)
 {
+   chess960_ = value && info_.supports960();
+   //
    if(!value)
    {
       if(info_.supports960())
@@ -607,11 +719,126 @@ const QString& ChessPlayer_LocalEngine::profileName() const
    return profileName_;
 }
 
+void ChessPlayer_LocalEngine::pingEngine()
+{
+   if(info_.type!=etUCI || pingPending_) return;
+   //
+   pingPending_ = true;
+   pingTime_.start();
+   tellEngine("isready");
+}
+
 void ChessPlayer_LocalEngine::forceMoveTimeout()
 {
    forceMoveTimer_.blockSignals(true);
    if(info_.type==etUCI)
    {
       tellEngine("stop"); // force engine to move immediately
+      watchdogTimer_.start(cStopResponseTimeoutMs);
+   }
+}
+
+void ChessPlayer_LocalEngine::stopSupervision()
+{
+   movePending_ = false;
+   watchdogTimer_.stop();
+   pingTimer_.stop();
+}
+
+void ChessPlayer_LocalEngine::engineFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+   if(shuttingDown_) return; // exit was expected
+   if(restarting_)
+   {
+      // the engine was killed by restartEngine()
+      startEngineAgain();
+      return;
+   }
+   //
+   std::string reason = exitStatus==QProcess::CrashExit ?
+            std::string("Engine process crashed") :
+            std::string("Engine process exited with code ") + uintToStr((unsigned)exitCode);
+   restartEngine(reason);
+}
+
+void ChessPlayer_LocalEngine::engineError(QProcess::ProcessError error)
+{
+   // crashes are handled by engineFinished(), the other errors
+   // (engine failed to start, pipe errors) are reported to the GUI
+   if(error==QProcess::Crashed) return;
+   //
+   if(restarting_)
+   {
+      restarting_ = false;
+      logEngineTalk(COMMENT, "Engine restart failed");
+   }
+   emit engineProcessError(error);
+}
+
+void ChessPlayer_LocalEngine::watchdogTimeout()
+{
+   if(!movePending_) return;
+   //
+   restartEngine("Engine did not move in time");
+}
+
+void ChessPlayer_LocalEngine::pingTimeout()
+{
+   if(!movePending_)
+   {
+      pingTimer_.stop();
+      return;
+   }
+   //
+   if(pingPending_)
+   {
+      // the unanswered 'isready' may have been sent before the move
+      // (e.g. after 'ucinewgame'), so its own age is what counts
+      if(pingTime_.elapsed()>=cPingTimeoutMs)
+         restartEngine("Engine does not respond to isready");
+   }
+   else
+   {
+      pingEngine();
+   }
+}
+
+void ChessPlayer_LocalEngine::restartEngine(const std::string& reason)
+{
+   logEngineTalk(COMMENT, reason);
+   //
+   stopSupervision();
+   forceMoveTimer_.blockSignals(true);
+   forceMoveTimer_.stop();
+   //
+   if(nRestarts_>=cMaxEngineRestarts)
+   {
+      logEngineTalk(COMMENT, "Too many engine restarts, giving up");
+      emit engineProcessError(QProcess::Crashed);
+      return;
+   }
+   ++nRestarts_;
+   //
+   restarting_ = true;
+   //
+   if(engineProcess_.state()!=QProcess::NotRunning)
+   {
+      // engineFinished() continues once the process has exited,
+      // so the GUI is not blocked while the engine is dying
+      engineProcess_.kill();
+      return;
    }
+   startEngineAgain();
+}
+
+void ChessPlayer_LocalEngine::startEngineAgain()
+{
+   pingPending_ = false;
+   inForceMode_ = false;
+   lastMoveReplayed_ = false;
+   incompleteLine_.clear();
+   timeManager_.reset();
+   //
+   performCleanup();
+   engineProcess_.start(info_.exePath);
 }
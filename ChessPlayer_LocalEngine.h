@@ -3,9 +3,11 @@
 
 #include "ChessPlayer.h"
 #include "EngineInfo.h"
+#include "EngineTimeManager.h"
 
 #include <QProcess>
 #include <QTimer>
+#include <QElapsedTimer>
 
 class ChessPlayer_LocalEngine : public ChessPlayer
 {
@@ -35,6 +37,9 @@ public:
 
    virtual void gameResult(ChessGameResult result);
 
+   virtual bool acceptsBookMoves() const;
+   virtual void bookMovePlayed(const ChessMove& lastMove, const ChessMove& move);
+
    virtual bool setChess960(bool value);
 
    const EngineInfo& info() const;
@@ -50,6 +55,10 @@ private slots:
    void engineHasOutput();
    void uciokTimeout();
    void forceMoveTimeout();
+   void engineFinished(int exitCode, QProcess::ExitStatus exitStatus);
+   void engineError(QProcess::ProcessError error);
+   void watchdogTimeout();
+   void pingTimeout();
 
 private:
    void tellEngine(const std::string& str);
@@ -57,6 +66,10 @@ private:
    void setUCIPonderOption(); // sets UCI engine Ponder option according to current GUI preference
    void engineTypeDetected(bool updateEngineIni=false);
    void performCleanup();
+   void pingEngine(); // measures engine response latency (UCI engines only)
+   void restartEngine(const std::string& reason); // kills hung or crashed engine and starts it again
+   void startEngineAgain(); // second half of restartEngine(), after the old process has exited
+   void stopSupervision();
 
 private:
    EngineInfo info_;
@@ -69,7 +82,17 @@ private:
    bool inForceMode_;   // (force mode is defined for XBoard engines only)
    QString profileName_;
    QTimer forceMoveTimer_;
-   int forceMoveTimeout_;
+   EngineTimeManager timeManager_;
+   QElapsedTimer pingTime_;
+   bool pingPending_;
+   QTimer watchdogTimer_; // fires if engine does not move within the expected time
+   QTimer pingTimer_;     // checks that engine stays responsive while thinking
+   bool movePending_;
+   bool restarting_;
+   bool shuttingDown_;
+   unsigned nRestarts_;   // restarts during the current game
+   bool chess960_;
+   bool lastMoveReplayed_; // last move was sent to XBoard engine by replayMove()
    bool randomizeMoveTimeout_;
    bool weakMode_;
 };
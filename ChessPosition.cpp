@@ -2,6 +2,8 @@
 #include "StringUtils.h"
 #include "Random.h"
 
+#include <string.h>
+
 // must be in ChessRules, but for convenience is placed here
 const std::string cStandardInitialFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 const ChessPosition cStandardInitialPosition = ChessPosition::fromString(cStandardInitialFen);
@@ -22,6 +24,8 @@ ChessPosition::ChessPosition() :
    isChess960_(false)
 {
    cells_.resize(maxCol_*maxRow_);
+   memset(pieceCounts_, 0, sizeof(pieceCounts_));
+   memset(lightSquareBishops_, 0, sizeof(lightSquareBishops_));
 }
 
 ColValue ChessPosition::maxCol() const
@@ -106,6 +110,11 @@ bool ChessPosition::canLongCastle() const
    return false;
 }
 
+unsigned ChessPosition::castlingFlags() const
+{
+   return castling_;
+}
+
 ChessCoord ChessPosition::pawnJump() const
 {
    return pawnJump_;
@@ -297,6 +306,8 @@ ChessPosition ChessPosition::fromString(const std::string& s)
       pos = pos2+1;
    }
    //
+   if(!position.countPieces()) return ChessPosition();
+   //
    skipSpace(s, pos);
    //
    if(pos>=s.length()) return ChessPosition();
@@ -476,6 +487,83 @@ void ChessPosition::setCell(ChessCoord c, ChessPiece piece)
    unsigned idx = toIndex(c);
    ChessPiece prevPiece = cells_[idx];
    cells_[idx] = piece;
+   //
+   if(prevPiece.type()!=ptNone) updateCounts(c, prevPiece, -1);
+   if(piece.type()!=ptNone) updateCounts(c, piece, 1);
+}
+
+void ChessPosition::updateCounts(ChessCoord c, ChessPiece piece, int delta)
+{
+   unsigned color = piece.color()==pcWhite ? 0 : 1;
+   ChessCoord *coords = pieceCoords_[color][piece.type()];
+   unsigned n = pieceCounts_[color][piece.type()];
+   if(delta>0)
+   {
+      assert(n<cMaxPiecesOfType);
+      coords[n] = c;
+   }
+   else
+   {
+      // order of the list does not matter, move the last item into the hole
+      unsigned i = 0;
+      while(i<n && coords[i]!=c) ++i;
+      assert(i<n);
+      coords[i] = coords[n-1];
+   }
+   //
+   pieceCounts_[color][piece.type()] += delta;
+   pieceCounts_[color][ptNone] += delta;
+   if(piece.type()==ptBishop && (c.col+c.row)%2==1)
+   {
+      lightSquareBishops_[color] += delta;
+   }
+}
+
+bool ChessPosition::countPieces()
+{
+   memset(pieceCounts_, 0, sizeof(pieceCounts_));
+   memset(lightSquareBishops_, 0, sizeof(lightSquareBishops_));
+   //
+   ChessCoord c;
+   for(c.row=1; c.row<=maxRow_; ++c.row)
+   {
+      for(c.col=1; c.col<=maxCol_; ++c.col)
+      {
+         ChessPiece piece = cell(c);
+         if(piece.type()==ptNone) continue;
+         if(pieceCount(piece.color(), piece.type())>=cMaxPiecesOfType) return false;
+         updateCounts(c, piece, 1);
+      }
+   }
+   return true;
+}
+
+unsigned ChessPosition::pieceCount(PieceColor color, PieceType type) const
+{
+   assert(type>=ptFirst && type<=ptLast);
+   return pieceCounts_[color==pcWhite ? 0 : 1][type];
+}
+
+unsigned ChessPosition::pieceCount(PieceColor color) const
+{
+   return pieceCounts_[color==pcWhite ? 0 : 1][ptNone];
+}
+
+unsigned ChessPosition::lightSquareBishopCount(PieceColor color) const
+{
+   return lightSquareBishops_[color==pcWhite ? 0 : 1];
+}
+
+ChessCoord ChessPosition::pieceCoord(PieceColor color, PieceType type, unsigned index) const
+{
+   assert(index<pieceCount(color, type));
+   return pieceCoords_[color==pcWhite ? 0 : 1][type][index];
+}
+
+ChessCoord ChessPosition::kingCoord(PieceColor color) const
+{
+   unsigned idx = color==pcWhite ? 0 : 1;
+   return pieceCounts_[idx][ptKing] ? pieceCoords_[idx][ptKing][0] : ChessCoord();
 }
 
 void ChessPosition::increaseHalfCount()
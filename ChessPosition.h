@@ -10,6 +10,8 @@
 
 typedef std::vector<ChessPiece> CellRow;
 
+const unsigned cMaxPiecesOfType = 10; // e.g. 2 initial knights + 8 promoted pawns
+
 // chess position according to FEN
 class ChessPosition
 {
@@ -26,6 +28,13 @@ public:
    ChessPiece cell(ChessCoord c) const;
    void setCell(ChessCoord c, ChessPiece piece);
    //
+   // piece counts and piece lists are kept up to date by setCell()
+   unsigned pieceCount(PieceColor color, PieceType type) const;
+   unsigned pieceCount(PieceColor color) const; // all pieces including king
+   unsigned lightSquareBishopCount(PieceColor color) const;
+   ChessCoord pieceCoord(PieceColor color, PieceType type, unsigned index) const; // index < pieceCount(color, type), in no particular order
+   ChessCoord kingCoord(PieceColor color) const; // ChessCoord() if there is no king
+   //
    ColValue leftRookInitialCol() const;  // for chess 960
    ColValue rightRookInitialCol() const;
    ColValue kingInitialCol() const;
@@ -47,6 +56,7 @@ public:
    bool canShortCastle() const;  // for the current side to move
    bool canLongCastle() const;
    bool canCastle() const;       // at least in one direction
+   unsigned castlingFlags() const; // castling rights of both sides as bits in FEN order (KQkq)
    //
    void prohibitShortCastling(); // for the current side to move
    void prohibitLongCastling();
@@ -63,6 +73,8 @@ public:
    //
 private:
    unsigned toIndex(ChessCoord c) const;
+   bool countPieces(); // after cells_ are filled directly, false if there are too many pieces of a type
+   void updateCounts(ChessCoord c, ChessPiece piece, int delta);
    void adjustCastlingPossibility(ChessCoord c);
 private:
    ColValue maxCol_;
@@ -81,6 +93,10 @@ private:
    bool isChess960_;
    //
    std::vector<ChessPiece> cells_;
+   //
+   unsigned char pieceCounts_[2][ptLast+1]; // [white/black][piece type], [..][ptNone] is the total
+   unsigned char lightSquareBishops_[2];
+   ChessCoord pieceCoords_[2][ptLast+1][cMaxPiecesOfType]; // [white/black][piece type][0..count-1]
 };
 
 extern const std::string cStandardInitialFen;
@@ -719,24 +719,6 @@ bool isCellAttackedBy(PieceColor attackerColor, const ChessPosition& position, C
           isCellAttackedByPawn(attackerColor, position, coord);
 }
 
-inline
-ChessCoord findPiecePosition(ChessPiece piece, const ChessPosition& position)
-{
-   ChessCoord coord;
-   //
-   RowValue maxRow = position.maxRow();
-   ColValue maxCol = position.maxCol();
-   //
-   for(coord.row=1; coord.row<=maxRow; ++coord.row)
-   {
-      for(coord.col=1; coord.col<=maxCol; ++coord.col)
-      {
-         if(position.cell(coord)==piece) return coord;
-      }
-   }
-   return ChessCoord();
-}
-
 inline
 void clearCellRange(ChessPosition& position, ChessCoord lo, ChessCoord hi)
 {
@@ -931,16 +913,13 @@ void ChessRules::findPossibleMoves(const ChessPosition &position, ChessMoveMap &
    //
    MoveList moveCandidates;
    //
-   ChessCoord coord;
-   //
-   RowValue maxRow = position.maxRow();
-   ColValue maxCol = position.maxCol();
-   //
-   for(coord.row=1; coord.row<=maxRow; ++coord.row)
+   // only cells occupied by pieces of the side to move are visited
+   PieceColor color = position.sideToMove();
+   for(PieceType type=ptFirst; type<=ptLast; ++type)
    {
-      for(coord.col=1; coord.col<=maxCol; ++coord.col)
+      for(unsigned i=0; i<position.pieceCount(color, type); ++i)
       {
-         appendCellMoves(position, coord, moveCandidates);
+         appendCellMoves(position, position.pieceCoord(color, type, i), moveCandidates);
       }
    }
    //
@@ -999,7 +978,7 @@ ChessMoveType ChessRules::applyMove(ChessPosition &position, const ChessMove& mo
 
 bool ChessRules::isKingChecked(PieceColor color, const ChessPosition& position) const
 {
-   ChessCoord kingCoord = findPiecePosition(ChessPiece(ptKing|color), position);
+   ChessCoord kingCoord = position.kingCoord(color);
    if(kingCoord == ChessCoord())
    {
       assert(false);
@@ -1039,3 +1018,26 @@ ChessCoord ChessRules::findAttacker(ChessPiece piece, const ChessPosition &posit
    }
    return ChessCoord(); // dummy line to suppress compiler warning
 }
+
+bool ChessRules::isInsufficientMaterial(const ChessPosition& position) const
+{
+   // uses piece counts maintained by ChessPosition, no board scan
+   unsigned nBishops = 0, nKnights = 0, nLightBishops = 0;
+   for(PieceColor color=pcWhite; ; color=pcBlack)
+   {
+      if(position.pieceCount(color, ptPawn) || position.pieceCount(color, ptRook) ||
+         position.pieceCount(color, ptQueen)) return false;
+      //
+      nBishops += position.pieceCount(color, ptBishop);
+      nKnights += position.pieceCount(color, ptKnight);
+      nLightBishops += position.lightSquareBishopCount(color);
+      //
+      if(color==pcBlack) break;
+   }
+   //
+   if(nBishops==0) return nKnights<=1;  // K vs K, KN vs K
+   if(nKnights>0) return false;         // e.g. KB vs KN can be mated with help
+   //
+   // any number of bishops, all of them on squares of the same color
+   return nLightBishops==0 || nLightBishops==nBishops;
+}
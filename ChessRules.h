@@ -34,6 +34,10 @@ public:
    // verifies if the current player's king is checked
    bool isKingChecked(PieceColor color, const ChessPosition& position) const;
 
+   // checks if neither side can checkmate by any sequence of legal moves because of
+   // insufficient material (lone kings, a single minor piece, bishops on one square color)
+   bool isInsufficientMaterial(const ChessPosition& position) const;
+
    // finds the given piece (KQRBN) attacking the given cell (if not found returns empty coords)
    ChessCoord findAttacker(ChessPiece piece, const ChessPosition &position, ChessCoord coord) const;
 
@@ -7,6 +7,9 @@ const CommandOption cmdOption_ExtMenu_Settings(cmd_ExtMenu_Settings, "ExtMenu_Se
 #ifdef CONFIG_DESKTOP
 const CommandOption cmdOption_ExtMenu_FEN(cmd_ExtMenu_FEN, "ExtMenu_FEN", srtMenuVar, Qt::Key_F);
 #endif
+const CommandOption cmdOption_ExtMenu_OpenGame(cmd_ExtMenu_OpenGame, "ExtMenu_OpenGame", srtMenuVar, Qt::Key_G);
+const CommandOption cmdOption_ExtMenu_ImportGames(cmd_ExtMenu_ImportGames, "ExtMenu_ImportGames", srtMenuVar, Qt::Key_I);
+const CommandOption cmdOption_ExtMenu_BuildBook(cmd_ExtMenu_BuildBook, "ExtMenu_BuildBook", srtMenuVar, Qt::Key_B);
 //const CommandOption cmdOption_ExtMenu_About(cmd_ExtMenu_About, "ExtMenu_About", srtMenuVar, Qt::Key_A);
 const CommandOption cmdOption_ExtMenu_Quit(cmd_ExtMenu_Quit, "ExtMenu_Quit", srtMenuVar, Qt::Key_Q);
 const CommandOption cmdOption_InGame_Takeback(cmd_InGame_Takeback, "InGame_Takeback", srtMenuVar, Qt::Key_T);
@@ -45,6 +48,9 @@ void CommandOptionDefs::initialize()
 #ifdef CONFIG_DESKTOP
    extMenuOptions_.add(cmdOption_ExtMenu_FEN);
 #endif
+   extMenuOptions_.add(cmdOption_ExtMenu_OpenGame);
+   extMenuOptions_.add(cmdOption_ExtMenu_ImportGames);
+   extMenuOptions_.add(cmdOption_ExtMenu_BuildBook);
    extMenuOptions_.add(cmdOption_ExtMenu_Quit);
    //
    inGameOptions_.add(cmdOption_InGame_Takeback);
@@ -11,6 +11,9 @@ const int cmd_NewGame_PlayerBlack = 2;
 const int cmd_NewGame_TwoPlayers = 3;
 const int cmd_ExtMenu_Settings = 10;
 const int cmd_ExtMenu_Quit = 11;
+const int cmd_ExtMenu_OpenGame = 13;
+const int cmd_ExtMenu_ImportGames = 14;
+const int cmd_ExtMenu_BuildBook = 15;
 const int cmd_InGame_Takeback = 20;
 const int cmd_InGame_OfferDraw = 21;
 const int cmd_InGame_Resign = 22;
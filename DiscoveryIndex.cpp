@@ -0,0 +1,213 @@
+#include "DiscoveryIndex.h"
+#include "StringUtils.h"
+
+#include <QFile>
+#include <QDir>
+#include <QDataStream>
+
+namespace
+{
+
+const quint32 cIndexSignature = 0x4B334449; // "K3DI"
+const quint32 cIndexVersion = 2;
+
+bool isUnder(const QString& path, const QString& dirPath)
+{
+   return path==dirPath || path.startsWith(dirPath + '/');
+}
+
+}
+
+DiscoveryIndex::DiscoveryIndex(const QString& indexFileName) :
+   indexFileName_(indexFileName), loaded_(false), modified_(false)
+{
+}
+
+QStringList DiscoveryIndex::findFiles(const QString& dirPath, FileFilter filter)
+{
+   load();
+   //
+   QStringList files;
+   std::set<QString> dirsFound;
+   findFilesProc(dirPath, filter, files, dirsFound);
+   removeMissing(dirPath, dirsFound, files);
+   //
+   return files;
+}
+
+void DiscoveryIndex::findFilesProc(const QString& dirPath, FileFilter filter,
+                                   QStringList& files, std::set<QString>& dirsFound)
+{
+   QFileInfo di(dirPath);
+   if(!di.isDir()) return;
+   //
+   dirsFound.insert(dirPath);
+   //
+   // adding, removing or renaming an item changes the modification
+   // time of the directory, otherwise the stored listing is still valid
+   qint64 modified = fileModificationTime(di);
+   DirEntry& entry = dirs_[dirPath];
+   if(entry.modified!=modified || modified==0)
+   {
+      entry = DirEntry();
+      entry.modified = modified;
+      //
+      QDir dir(dirPath);
+      dir.setFilter(QDir::Files | QDir::Dirs);
+      QFileInfoList items = dir.entryInfoList();
+      foreach(QFileInfo fi, items)
+      {
+         if(fi.isDir())
+         {
+            if(!fi.fileName().startsWith("."))
+               entry.subdirs.append(fi.fileName());
+         }
+         else if(filter(fi.fileName()))
+         {
+            entry.files.append(fi.fileName());
+         }
+      }
+      modified_ = true;
+   }
+   //
+   foreach(QString fileName, entry.files)
+   {
+      files.append(dirPath + '/' + fileName);
+   }
+   //
+   QStringList subdirs = entry.subdirs; // entry may not outlive changes of dirs_
+   foreach(QString subdir, subdirs)
+   {
+      findFilesProc(dirPath + '/' + subdir, filter, files, dirsFound);
+   }
+}
+
+void DiscoveryIndex::removeMissing(const QString& dirPath, const std::set<QString>& dirsFound,
+                                   const QStringList& files)
+{
+   std::set<QString> filesFound(files.begin(), files.end());
+   //
+   DirMap::iterator dit = dirs_.begin();
+   while(dit!=dirs_.end())
+   {
+      if(isUnder(dit->first, dirPath) && dirsFound.find(dit->first)==dirsFound.end())
+      {
+         dirs_.erase(dit++);
+         modified_ = true;
+      }
+      else
+         ++dit;
+   }
+   //
+   FileMap::iterator fit = files_.begin();
+   while(fit!=files_.end())
+   {
+      if(isUnder(fit->first, dirPath) && filesFound.find(fit->first)==filesFound.end())
+      {
+         files_.erase(fit++);
+         modified_ = true;
+      }
+      else
+         ++fit;
+   }
+}
+
+bool DiscoveryIndex::cachedData(const QFileInfo& fi, QByteArray& data)
+{
+   load();
+   //
+   FileMap::const_iterator it = files_.find(fi.filePath());
+   if(it==files_.end()) return false;
+   //
+   const FileEntry& entry = it->second;
+   if(entry.size!=fi.size() || entry.modified!=fileModificationTime(fi)) return false;
+   //
+   data = entry.data;
+   return true;
+}
+
+void DiscoveryIndex::setData(const QFileInfo& fi, const QByteArray& data)
+{
+   FileEntry& entry = files_[fi.filePath()];
+   entry.size = fi.size();
+   entry.modified = fileModificationTime(fi);
+   entry.data = data;
+   modified_ = true;
+}
+
+void DiscoveryIndex::load()
+{
+   if(loaded_) return;
+   loaded_ = true;
+   //
+   QFile file(indexFileName_);
+   if(!file.open(QIODevice::ReadOnly)) return;
+   //
+   QDataStream in(&file);
+   in.setVersion(QDataStream::Qt_4_0);
+   //
+   quint32 signature = 0, version = 0, nDirs = 0, nFiles = 0;
+   QString currentPath;
+   in >> signature >> version >> currentPath;
+   //
+   // paths are relative to the program directory and parsed data
+   // (e.g. engine executable paths) may be absolute
+   if(signature!=cIndexSignature || version!=cIndexVersion ||
+      currentPath!=QDir::currentPath()) return;
+   //
+   in >> nDirs;
+   for(quint32 i=0; i<nDirs && in.status()==QDataStream::Ok; ++i)
+   {
+      QString path;
+      DirEntry entry;
+      in >> path >> entry.modified >> entry.subdirs >> entry.files;
+      dirs_[path] = entry;
+   }
+   //
+   in >> nFiles;
+   for(quint32 i=0; i<nFiles && in.status()==QDataStream::Ok; ++i)
+   {
+      QString path;
+      FileEntry entry;
+      in >> path >> entry.size >> entry.modified >> entry.data;
+      files_[path] = entry;
+   }
+   //
+   if(in.status()!=QDataStream::Ok || dirs_.size()!=nDirs || files_.size()!=nFiles)
+   {
+      // damaged index, everything is enumerated again
+      dirs_.clear();
+      files_.clear();
+   }
+}
+
+bool DiscoveryIndex::save()
+{
+   if(!modified_) return true;
+   //
+   QFile file(indexFileName_);
+   if(!file.open(QIODevice::WriteOnly|QIODevice::Truncate)) return false;
+   //
+   QDataStream out(&file);
+   out.setVersion(QDataStream::Qt_4_0);
+   //
+   out << cIndexSignature << cIndexVersion << QDir::currentPath();
+   //
+   out << (quint32)dirs_.size();
+   for(DirMap::const_iterator it=dirs_.begin(); it!=dirs_.end(); ++it)
+   {
+      const DirEntry& entry = it->second;
+      out << it->first << entry.modified << entry.subdirs << entry.files;
+   }
+   //
+   out << (quint32)files_.size();
+   for(FileMap::const_iterator it=files_.begin(); it!=files_.end(); ++it)
+   {
+      const FileEntry& entry = it->second;
+      out << it->first << entry.size << entry.modified << entry.data;
+   }
+   //
+   if(out.status()!=QDataStream::Ok) return false;
+   modified_ = false;
+   return true;
+}
@@ -0,0 +1,74 @@
+#ifndef __DiscoveryIndex_h
+#define __DiscoveryIndex_h
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QFileInfo>
+
+#include <map>
+#include <set>
+
+// DiscoveryIndex remembers what was found in the engines, pieces and
+// locales directories between sessions: directory listings with their
+// modification times and, for every found file, its size, modification
+// time and the data parsed from it (see K3ChessSettings); directories
+// are listed again and files parsed again only if they have changed,
+// so enumeration time depends on the number of changed files rather
+// than on the installed content
+
+class DiscoveryIndex
+{
+public:
+   typedef bool (*FileFilter)(const QString& fileName);
+
+   explicit DiscoveryIndex(const QString& indexFileName);
+
+   // files of the directory tree accepted by the filter (subdirectories
+   // starting with '.' are skipped); entries of files no longer found
+   // under the directory are removed from the index
+   QStringList findFiles(const QString& dirPath, FileFilter filter);
+
+   // data stored for the file, false if the file is new or has changed
+   bool cachedData(const QFileInfo& fi, QByteArray& data);
+   void setData(const QFileInfo& fi, const QByteArray& data);
+
+   bool save(); // writes the index file if anything has changed
+
+private:
+   struct DirEntry
+   {
+      qint64 modified; // ms since the epoch
+      QStringList subdirs;
+      QStringList files; // accepted by the filter
+      //
+      DirEntry() : modified(0) {}
+   };
+
+   struct FileEntry
+   {
+      qint64 size;
+      qint64 modified;
+      QByteArray data;
+      //
+      FileEntry() : size(0), modified(0) {}
+   };
+
+   typedef std::map<QString, DirEntry> DirMap;
+   typedef std::map<QString, FileEntry> FileMap;
+
+   void findFilesProc(const QString& dirPath, FileFilter filter,
+                      QStringList& files, std::set<QString>& dirsFound);
+   void removeMissing(const QString& dirPath, const std::set<QString>& dirsFound,
+                      const QStringList& files);
+   void load();
+
+private:
+   QString indexFileName_;
+   bool loaded_;
+   bool modified_;
+   DirMap dirs_;
+   FileMap files_;
+};
+
+#endif
@@ -0,0 +1,133 @@
+#include "EngineTimeManager.h"
+
+#include <QtGlobal>
+
+namespace
+{
+
+const int cDefaultFixedMoveTime = 3000; // ms, for untimed games
+const int cMinMoveTime = 50;            // ms, never ask engine to think less than that
+const int cSafetyMargin = 100;          // ms, reserved on the clock for GUI overhead
+const int cMinMovesToGo = 12;           // expected moves left in a bare endgame
+const int cMaxMovesToGo = 35;           // expected moves left in the opening
+const int cMaxGamePhase = 24;           // material phase of the initial position
+
+// returns game phase from cMaxGamePhase (all pieces on board) to 0 (pawns and kings only)
+int gamePhase(const ChessPosition& position)
+{
+   int phase = 0;
+   //
+   ChessCoord coord;
+   for(coord.row=1; coord.row<=position.maxRow(); ++coord.row)
+   {
+      for(coord.col=1; coord.col<=position.maxCol(); ++coord.col)
+      {
+         switch(position.cell(coord).type())
+         {
+            case ptQueen:  phase += 4; break;
+            case ptRook:   phase += 2; break;
+            case ptBishop:
+            case ptKnight: phase += 1; break;
+            default:
+               break;
+         }
+      }
+   }
+   //
+   return qMin(phase, cMaxGamePhase);
+}
+
+int estimateMovesToGo(const ChessPosition& position)
+{
+   int movesToGo = cMinMovesToGo +
+         (cMaxMovesToGo-cMinMovesToGo)*gamePhase(position)/cMaxGamePhase;
+   //
+   // the longer the game already lasts, the fewer moves are likely to follow
+   int movesPlayed = (int)position.moveNumber();
+   if(movesPlayed>60)
+   {
+      movesToGo -= qMin(movesToGo-cMinMovesToGo, (movesPlayed-60)/4);
+   }
+   //
+   return movesToGo;
+}
+
+}
+
+EngineTimeManager::EngineTimeManager() :
+   fixedMoveTime_(cDefaultFixedMoveTime), maxMoveTime_(0),
+   latency_(0), nLatencySamples_(0)
+{
+}
+
+void EngineTimeManager::reset()
+{
+   latency_ = 0;
+   nLatencySamples_ = 0;
+}
+
+void EngineTimeManager::setFixedMoveTime(int ms)
+{
+   fixedMoveTime_ = qMax(ms, cMinMoveTime);
+}
+
+void EngineTimeManager::setMaxMoveTime(int ms)
+{
+   maxMoveTime_ = qMax(ms, 0);
+}
+
+void EngineTimeManager::addLatencySample(int ms)
+{
+   if(ms<0) return;
+   //
+   if(nLatencySamples_==0)
+   {
+      latency_ = ms;
+   }
+   else
+   {
+      latency_ = (latency_*3 + ms)/4; // exponential smoothing
+   }
+   ++nLatencySamples_;
+}
+
+int EngineTimeManager::latency() const
+{
+   return latency_;
+}
+
+MoveTimeBudget EngineTimeManager::getBudget(const ChessClock& clock,
+                                            const ChessPosition& position) const
+{
+   MoveTimeBudget budget;
+   //
+   if(clock.untimed)
+   {
+      budget.fixedMoveTime = true;
+      budget.optimumTime = fixedMoveTime_;
+      if(maxMoveTime_>0) budget.optimumTime = qMin(budget.optimumTime, maxMoveTime_);
+      budget.maximumTime = budget.optimumTime + latency_;
+      return budget;
+   }
+   //
+   budget.movesToGo = estimateMovesToGo(position);
+   //
+   // the command reaches the engine and the reply reaches us with a delay,
+   // so reserve twice the pipe latency on top of a fixed safety margin
+   int available = clock.remainingTime - cSafetyMargin - latency_*2;
+   if(available<cMinMoveTime) available = cMinMoveTime;
+   //
+   int optimum = available/budget.movesToGo + clock.moveIncrement*3/4;
+   int maximum = qMin(optimum*3, available/3 + clock.moveIncrement);
+   //
+   if(maxMoveTime_>0)
+   {
+      optimum = qMin(optimum, maxMoveTime_);
+      maximum = qMin(maximum, maxMoveTime_);
+   }
+   //
+   budget.optimumTime = qMax(qMin(optimum, available), cMinMoveTime);
+   budget.maximumTime = qMax(qMin(maximum, available), budget.optimumTime);
+   //
+   return budget;
+}
@@ -0,0 +1,45 @@
+#ifndef __EngineTimeManager_h
+#define __EngineTimeManager_h
+
+#include "ChessClock.h"
+#include "ChessPosition.h"
+
+// thinking time allotted to an engine for a single move
+struct MoveTimeBudget
+{
+   int optimumTime;    // ms, time the engine is expected to spend on the move
+   int maximumTime;    // ms, hard limit after which the engine is forced to move
+   int movesToGo;      // estimated number of moves left to play with the remaining time (not sent to engines)
+   bool fixedMoveTime; // clock is untimed, engine should think exactly optimumTime ms
+   //
+   MoveTimeBudget() : optimumTime(0), maximumTime(0), movesToGo(0), fixedMoveTime(false) {}
+};
+
+// EngineTimeManager computes per-move time budgets from the engine clock,
+// move number and game phase, taking into account the measured latency
+// of the GUI-to-engine pipe
+
+class EngineTimeManager
+{
+public:
+   EngineTimeManager();
+
+   void reset(); // forget latency samples (e.g. when engine process is restarted)
+
+   void setFixedMoveTime(int ms); // time per move for untimed games
+   void setMaxMoveTime(int ms);   // upper limit for any budget (0 means no limit)
+
+   void addLatencySample(int ms); // measured command round trip time
+   int latency() const;           // smoothed round trip time, ms
+
+   MoveTimeBudget getBudget(const ChessClock& clock,
+                            const ChessPosition& position) const;
+
+private:
+   int fixedMoveTime_;
+   int maxMoveTime_;
+   int latency_;
+   unsigned nLatencySamples_;
+};
+
+#endif
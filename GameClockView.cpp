@@ -1,4 +1,5 @@
 #include "GameClockView.h"
+#include "RepaintScheduler.h"
 #include <QPainter>
 #include <QPaintEvent>
 #include <QPixmap>
@@ -23,7 +24,7 @@ GameClockView::GameClockView(QWidget *parent) :
 void GameClockView::resizeEvent(QResizeEvent*)
 {
    updateLayout();
-   repaint();
+   g_repaintScheduler.schedule(this);
 }
 
 void GameClockView::paintEvent(QPaintEvent *event)
@@ -63,7 +64,7 @@ void GameClockView::setLeftPlayerName(const QString &name)
    if(leftPlayerName_==name) return;
    leftPlayerName_ = name;
    updateLayout();
-   repaint(QRect(leftPlayerNameRect_.left(), 0, rect().width()/2-leftPlayerNameRect_.left(), rect().height()));
+   g_repaintScheduler.schedule(this, QRect(leftPlayerNameRect_.left(), 0, rect().width()/2-leftPlayerNameRect_.left(), rect().height()));
 }
 
 void GameClockView::setRightPlayerName(const QString &name)
@@ -71,7 +72,7 @@ void GameClockView::setRightPlayerName(const QString &name)
    if(rightPlayerName_==name) return;
    rightPlayerName_ = name;
    updateLayout();
-   repaint(QRect(rect().width()/2, 0, rightPlayerNameRect_.right()-rect().width()/2, rect().height()));
+   g_repaintScheduler.schedule(this, QRect(rect().width()/2, 0, rightPlayerNameRect_.right()-rect().width()/2, rect().height()));
 }
 
 void GameClockView::setLeftClock(QTime time)
@@ -79,7 +80,7 @@ void GameClockView::setLeftClock(QTime time)
    QString clockText = getClockText(time);
    if(leftClockText_==clockText) return;
    leftClockText_ = clockText;
-   repaint(leftClockRect_);
+   g_repaintScheduler.schedule(this, leftClockRect_);
 }
 
 void GameClockView::setRightClock(QTime time)
@@ -87,14 +88,14 @@ void GameClockView::setRightClock(QTime time)
    QString clockText = getClockText(time);
    if(rightClockText_==clockText) return;
    rightClockText_ = clockText;
-   repaint(rightClockRect_);
+   g_repaintScheduler.schedule(this, rightClockRect_);
 }
 
 void GameClockView::setActiveSide(ClockActiveSide value)
 {
    if(activeSide_==value) return;
    activeSide_ = value;
-   repaint();
+   g_repaintScheduler.schedule(this);
 }
 
 void GameClockView::draw(QPainter &painter, const QRect &clipRect)
@@ -123,5 +124,5 @@ void GameClockView::mousePressEvent(QMouseEvent *)
 void GameClockView::setClockFont(const QFont &font)
 {
    clockFont_ = font;
-   repaint();
+   g_repaintScheduler.schedule(this);
 }
@@ -0,0 +1,223 @@
+#include "GameJournal.h"
+#include "StringUtils.h"
+
+#include <QDir>
+#include <QTextStream>
+#include <QTextCodec>
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+const char *cJournalSignature = "K3ChessJournal 1";
+const int cSyncInterval = 2000;       // ms, max time a record may stay in OS buffers
+const unsigned cSyncRecordCount = 8;  // records written between forced syncs
+
+// journal records (one per line):
+//    m <move> [<white remaining ms> <black remaining ms>]
+//    u <number of moves taken back>
+
+bool parseMoveRecord(const std::string& line, ChessMove& move,
+                     int& whiteTime, int& blackTime, bool& hasClocks)
+{
+   unsigned pos = 2;
+   skipSpace(line, pos);
+   unsigned start = pos;
+   skipNonSpace(line, pos);
+   move = ChessMove::fromString(line.substr(start, pos-start));
+   if(!move.assigned()) return false;
+   //
+   skipSpace(line, pos);
+   hasClocks = pos<line.length();
+   if(!hasClocks) return true;
+   //
+   unsigned parsed = pos;
+   whiteTime = (int)strToUint(line, pos, parsed);
+   if(parsed==pos) return false;
+   pos = parsed;
+   skipSpace(line, pos);
+   blackTime = (int)strToUint(line, pos, parsed);
+   return parsed>pos;
+}
+
+}
+
+GameJournal::GameJournal() : nUnsyncedRecords_(0)
+{
+   syncTimer_.setSingleShot(true);
+   QObject::connect(&syncTimer_, SIGNAL(timeout()), this, SLOT(syncTimeout()));
+}
+
+GameJournal::~GameJournal()
+{
+   close();
+}
+
+bool GameJournal::open(const QString& fileName, const GameSessionInfo& sessionInfo)
+{
+   close();
+   //
+   file_.setFileName(fileName);
+   if(!file_.open(QIODevice::WriteOnly|QIODevice::Truncate))
+   {
+      // could not create journal, the game will only be saved on exit
+      return false;
+   }
+   //
+   QTextStream out(&file_);
+   out.setCodec(QTextCodec::codecForName("UTF-8"));
+   //
+   out << cJournalSignature << "\n";
+   sessionInfo.writeHeader(out);
+   //
+   for(unsigned i=0; i<sessionInfo.moves.size(); ++i)
+   {
+      out << "m " << sessionInfo.moves[i].toString().c_str() << "\n";
+   }
+   out.flush();
+   //
+   sync();
+   return true;
+}
+
+void GameJournal::close()
+{
+   if(!file_.isOpen()) return;
+   //
+   sync();
+   file_.close();
+}
+
+bool GameJournal::isOpen() const
+{
+   return file_.isOpen();
+}
+
+void GameJournal::appendMove(const ChessMove& move, const ChessClock& whiteClock,
+                             const ChessClock& blackClock)
+{
+   std::string record;
+   record.reserve(32);
+   record.append("m ");
+   record.append(move.toString());
+   record.append(" ");
+   record.append(uintToStr(whiteClock.remainingTime));
+   record.append(" ");
+   record.append(uintToStr(blackClock.remainingTime));
+   appendRecord(record);
+}
+
+void GameJournal::appendTakeback(unsigned nMoves)
+{
+   if(nMoves==0) return;
+   appendRecord(std::string("u ") + uintToStr(nMoves));
+}
+
+void GameJournal::appendRecord(const std::string& record)
+{
+   if(!file_.isOpen()) return;
+   //
+   file_.write(record.c_str(), record.length());
+   file_.write("\n", 1);
+   //
+   // hand the record over to the OS right away, so it survives
+   // a crash of the program; syncing to the storage device is
+   // much slower and is batched
+   file_.flush();
+   //
+   ++nUnsyncedRecords_;
+   if(nUnsyncedRecords_>=cSyncRecordCount)
+   {
+      sync();
+   }
+   else if(!syncTimer_.isActive())
+   {
+      syncTimer_.start(cSyncInterval);
+   }
+}
+
+void GameJournal::sync()
+{
+   syncTimer_.stop();
+   if(!file_.isOpen()) return;
+   //
+   file_.flush();
+#if defined(Q_OS_WIN)
+   _commit(file_.handle());
+#else
+   fsync(file_.handle());
+#endif
+   nUnsyncedRecords_ = 0;
+}
+
+void GameJournal::syncTimeout()
+{
+   sync();
+}
+
+bool GameJournal::load(const QString& fileName, GameSessionInfo& sessionInfo)
+{
+   QFile file(fileName);
+   if(!file.open(QIODevice::ReadOnly)) return false;
+   //
+   QByteArray data = file.readAll();
+   //
+   // a record that was being written when the program died has no
+   // line end, such a record is ignored
+   int lastLineEnd = data.lastIndexOf('\n');
+   if(lastLineEnd<0) return false;
+   data.truncate(lastLineEnd+1);
+   //
+   QTextStream in(&data, QIODevice::ReadOnly);
+   in.setCodec(QTextCodec::codecForName("UTF-8"));
+   //
+   if(in.readLine()!=cJournalSignature) return false;
+   if(!sessionInfo.readHeader(in)) return false;
+   //
+   sessionInfo.moves.clear();
+   //
+   while(!in.atEnd())
+   {
+      std::string line = toStdString(in.readLine());
+      if(line.length()<2 || line[1]!=' ') break;
+      //
+      if(line[0]=='m')
+      {
+         ChessMove move;
+         int whiteTime = 0, blackTime = 0;
+         bool hasClocks = false;
+         if(!parseMoveRecord(line, move, whiteTime, blackTime, hasClocks)) break;
+         //
+         sessionInfo.moves.push_back(move);
+         if(hasClocks)
+         {
+            sessionInfo.profile.whiteClock.remainingTime = whiteTime;
+            sessionInfo.profile.blackClock.remainingTime = blackTime;
+         }
+      }
+      else if(line[0]=='u')
+      {
+         unsigned parsed = 0;
+         unsigned n = strToUint(line, 2, parsed);
+         if(parsed==2 || n>sessionInfo.moves.size()) break;
+         sessionInfo.moves.resize(sessionInfo.moves.size()-n);
+      }
+      else
+      {
+         break; // unknown record, probably a damaged file
+      }
+   }
+   //
+   return true;
+}
+
+void GameJournal::remove(const QString& fileName)
+{
+   QDir dir(extractFolderPath(fileName));
+   dir.remove(fileName);
+}
@@ -0,0 +1,47 @@
+#ifndef __GameJournal_h
+#define __GameJournal_h
+
+#include "GameSessionInfo.h"
+
+#include <QObject>
+#include <QFile>
+#include <QTimer>
+
+// GameJournal keeps the game in progress on disk as an append-only file:
+// the session header is written once, then every move adds a short record,
+// so the game survives a crash or a sudden power loss without rewriting
+// the whole session file on each move
+
+class GameJournal : public QObject
+{
+   Q_OBJECT
+public:
+   GameJournal();
+   ~GameJournal();
+
+   bool open(const QString& fileName, const GameSessionInfo& sessionInfo); // starts a new journal (header + moves played so far)
+   void close();
+   bool isOpen() const;
+
+   void appendMove(const ChessMove& move, const ChessClock& whiteClock,
+                   const ChessClock& blackClock);
+   void appendTakeback(unsigned nMoves);
+
+   void sync(); // forces pending records to disk
+
+   static bool load(const QString& fileName, GameSessionInfo& sessionInfo);
+   static void remove(const QString& fileName);
+
+private slots:
+   void syncTimeout();
+
+private:
+   void appendRecord(const std::string& record);
+
+private:
+   QFile file_;
+   QTimer syncTimer_;
+   unsigned nUnsyncedRecords_;
+};
+
+#endif
@@ -21,6 +21,10 @@ QString gameResultToMessage(ChessGameResult result)
       case resultDrawnByStalemate:  return g_msg("GameDrawnByStalemate");
       case resultDrawnByRepetition: return g_msg("GameDrawnByRepetition");
       case resultDrawnBy50MoveRule: return g_msg("GameDrawnBy50MoveRule");
+      case resultWhiteWinsByAdjudication: return g_msg("WhiteWinsByAdjudication");
+      case resultBlackWinsByAdjudication: return g_msg("BlackWinsByAdjudication");
+      case resultDrawnByAdjudication: return g_msg("GameDrawnByAdjudication");
+      case resultDrawnByInsufficientMaterial: return g_msg("GameDrawnByInsufficientMaterial");
       case resultWhiteCheckmates:   return g_msg("WhiteCheckmates");
       case resultBlackCheckmates:   return g_msg("BlackCheckmates");
       case resultWhiteWonOnTime:    return g_msg("WhiteWonOnTime");
@@ -51,7 +55,7 @@ GameSession::GameSession(ChessPlayer *whitePlayer, ChessPlayer *blackPlayer,
    game_(whitePlayer->name(), blackPlayer->name()),
    whitePlayerReady_(false), blackPlayerReady_(false),
    sessionInfo_(initialInfo), whiteDrawOfferActive_(false), blackDrawOfferActive_(false),
-   canDrawByRepetition_(false), clockRedrawInterval_(1)
+   canDrawByRepetition_(false), clockRedrawInterval_(1), tablebaseHint_(tbUnknown)
 {
    QObject::connect(&getReadyTimer_, SIGNAL(timeout()), this, SLOT(getReadyTimeout()), Qt::UniqueConnection);
    QObject::connect(&clockUpdateTimer_, SIGNAL(timeout()), this, SLOT(clockUpdateTimer()), Qt::UniqueConnection);
@@ -120,11 +124,109 @@ void GameSession::getReadyTimeout()
 
 void GameSession::requestMove(ChessPlayer *player)
 {
+   if(requestBookMove(player)) return;
+   //
    player->makeMove(game_.position(), game_.lastMove(),
                     sessionInfo_.profile.whiteClock,
                     sessionInfo_.profile.blackClock);
 }
 
+bool GameSession::requestBookMove(ChessPlayer *player)
+{
+   if(!book_.isOpen() || !player->acceptsBookMoves()) return false;
+   //
+   ChessMove move;
+   if(!book_.pickMove(game_.position(), move)) return false;
+   //
+   player->bookMovePlayed(game_.lastMove(), move);
+   //
+   // the move is played from the event loop, as if the player has sent it
+   bookMove_ = move;
+   QTimer::singleShot(0, this, SLOT(playBookMove()));
+   return true;
+}
+
+void GameSession::playBookMove()
+{
+   ChessMove move = bookMove_;
+   bookMove_ = ChessMove();
+   //
+   if(!move.assigned() || game_.result()!=resultNone) return;
+   //
+   if(game_.position().sideToMove()==pcWhite)
+      white_moves(move);
+   else
+      black_moves(move);
+}
+
+bool GameSession::adjudicateByTablebases()
+{
+   if(!g_settings.adjudicateByTablebases()) return false;
+   //
+   TablebaseResult result = SyzygyTablebases::probeWDL(game_.position());
+   if(result==tbUnknown) return false;
+   //
+   bool whiteToMove = game_.position().sideToMove()==pcWhite;
+   if(type()!=gameTwoEngines)
+   {
+      // a local human plays on (and may still go wrong or fight back),
+      // the result is only shown as a hint each time it changes
+      TablebaseResult whiteResult = result;
+      if(!whiteToMove && result!=tbDraw) whiteResult = result==tbWin ? tbLoss : tbWin;
+      if(whiteResult!=tablebaseHint_)
+      {
+         tablebaseHint_ = whiteResult;
+         const char *key = whiteResult==tbWin ? "TablebaseWhiteWins" :
+                           whiteResult==tbLoss ? "TablebaseBlackWins" : "TablebaseDraw";
+         g_localChessGui.showSessionMessage(g_msg("TablebaseHint").arg(g_msg(key)));
+      }
+      return false;
+   }
+   //
+   switch(result)
+   {
+      case tbWin:
+         endGame(reasonGameFinished, whiteToMove ? resultWhiteWinsByAdjudication :
+                                                   resultBlackWinsByAdjudication);
+         break;
+      case tbLoss:
+         endGame(reasonGameFinished, whiteToMove ? resultBlackWinsByAdjudication :
+                                                   resultWhiteWinsByAdjudication);
+         break;
+      default:
+         endGame(reasonGameFinished, resultDrawnByAdjudication);
+         break;
+   }
+   return true;
+}
+
+void GameSession::resyncPlayer(ChessPlayer *player, PieceColor color)
+{
+   if(game_.result()!=resultNone) return;
+   //
+   g_localChessGui.showSessionMessage(g_msg("PlayerRestarted").arg(player->name()));
+   //
+   if(color==pcWhite)
+      player->beginGame(pcWhite, blackPlayer_->name(), whiteClock_);
+   else
+      player->beginGame(pcBlack, whitePlayer_->name(), blackClock_);
+   //
+   player->setInitialPosition(sessionInfo_.initialPosition);
+   //
+   std::vector<ChessMove>::const_iterator it = game_.moves().begin(),
+                                          itEnd = game_.moves().end();
+   for(;it!=itEnd;++it)
+   {
+      player->replayMove(*it);
+   }
+   //
+   // re-issue the move request that the player has lost
+   if(game_.position().sideToMove()==color)
+   {
+      requestMove(player);
+   }
+}
+
 void GameSession::white_isReady()
 {
    whitePlayerReady_ = true;
@@ -149,6 +251,7 @@ void GameSession::white_moves(const ChessMove& move)
    else
    {
       updateSessionInfo();
+      journalLastMove();
       //
       if(blackDrawOfferActive_)
       {
@@ -166,7 +269,8 @@ void GameSession::white_moves(const ChessMove& move)
       updateCapturedPieces();
       //
       blackPlayer_->opponentMoves(move);
-      if(game_.result()==resultNone && sessionInfo_.profile.blackClock.remainingTime > 0)
+      if(game_.result()==resultNone && !adjudicateByTablebases() &&
+         sessionInfo_.profile.blackClock.remainingTime > 0)
       {
          requestMove(blackPlayer_);
       }
@@ -240,6 +344,7 @@ void GameSession::black_moves(const ChessMove& move)
    else
    {
       updateSessionInfo();
+      journalLastMove();
       //
       if(whiteDrawOfferActive_)
       {
@@ -262,7 +367,8 @@ void GameSession::black_moves(const ChessMove& move)
       updateCapturedPieces();
       //
       whitePlayer_->opponentMoves(move);
-      if(game_.result()==resultNone && whiteClock_.remainingTime > 0)
+      if(game_.result()==resultNone && !adjudicateByTablebases() &&
+         whiteClock_.remainingTime > 0)
       {
          requestMove(whitePlayer_);
       }
@@ -329,6 +435,11 @@ void GameSession::fiftyMovesDetected()
    endGame(reasonGameFinished, resultDrawnBy50MoveRule);
 }
 
+void GameSession::insufficientMaterialDetected()
+{
+   endGame(reasonGameFinished, resultDrawnByInsufficientMaterial);
+}
+
 void GameSession::repetitionDetected()
 {
    canDrawByRepetition_ = true;
@@ -344,6 +455,7 @@ void GameSession::connectPlayers()
    QObject::connect(whitePlayer_, SIGNAL(playerSays(const QString&)), this, SLOT(white_says(const QString&)), Qt::UniqueConnection);
    QObject::connect(whitePlayer_, SIGNAL(playerRequestsTakeback()), this, SLOT(white_requestsTakeback()), Qt::UniqueConnection);
    QObject::connect(whitePlayer_, SIGNAL(playerRequestsAbort()), this, SLOT(white_requestsAbort()), Qt::UniqueConnection);
+   QObject::connect(whitePlayer_, SIGNAL(playerRestarted()), this, SLOT(white_restarted()), Qt::UniqueConnection);
    //
    QObject::connect(blackPlayer_, SIGNAL(isReady()), this, SLOT(black_isReady()), Qt::UniqueConnection);
    QObject::connect(blackPlayer_, SIGNAL(playerMoves(ChessMove)), this, SLOT(black_moves(ChessMove)), Qt::UniqueConnection);
@@ -353,6 +465,7 @@ void GameSession::connectPlayers()
    QObject::connect(blackPlayer_, SIGNAL(playerSays(const QString&)), this, SLOT(black_says(const QString&)), Qt::UniqueConnection);
    QObject::connect(blackPlayer_, SIGNAL(playerRequestsTakeback()), this, SLOT(black_requestsTakeback()), Qt::UniqueConnection);
    QObject::connect(blackPlayer_, SIGNAL(playerRequestsAbort()), this, SLOT(black_requestsAbort()), Qt::UniqueConnection);
+   QObject::connect(blackPlayer_, SIGNAL(playerRestarted()), this, SLOT(black_restarted()), Qt::UniqueConnection);
 }
 
 void GameSession::disconnectPlayers()
@@ -365,6 +478,7 @@ void GameSession::disconnectPlayers()
    QObject::disconnect(whitePlayer_, SIGNAL(playerSays(const QString&)), this, SLOT(white_says(const QString&)));
    QObject::disconnect(whitePlayer_, SIGNAL(playerRequestsTakeback()), this, SLOT(white_requestsTakeback()));
    QObject::disconnect(whitePlayer_, SIGNAL(playerRequestsAbort()), this, SLOT(white_requestsAbort()));
+   QObject::disconnect(whitePlayer_, SIGNAL(playerRestarted()), this, SLOT(white_restarted()));
    //
    QObject::disconnect(blackPlayer_, SIGNAL(isReady()), this, SLOT(black_isReady()));
    QObject::disconnect(blackPlayer_, SIGNAL(playerMoves(ChessMove)), this, SLOT(black_moves(ChessMove)));
@@ -374,6 +488,7 @@ void GameSession::disconnectPlayers()
    QObject::disconnect(blackPlayer_, SIGNAL(playerSays(const QString&)), this, SLOT(black_says(const QString&)));
    QObject::disconnect(blackPlayer_, SIGNAL(playerRequestsTakeback()), this, SLOT(black_requestsTakeback()));
    QObject::disconnect(blackPlayer_, SIGNAL(playerRequestsAbort()), this, SLOT(black_requestsAbort()));
+   QObject::disconnect(blackPlayer_, SIGNAL(playerRestarted()), this, SLOT(black_restarted()));
 }
 
 void GameSession::connectGame()
@@ -382,6 +497,7 @@ void GameSession::connectGame()
    QObject::connect(&game_, SIGNAL(stalemateDetected()), this, SLOT(stalemateDetected()), Qt::UniqueConnection);
    QObject::connect(&game_, SIGNAL(fiftyMovesDetected()), this, SLOT(fiftyMovesDetected()), Qt::UniqueConnection);
    QObject::connect(&game_, SIGNAL(repetitionDetected()), this, SLOT(repetitionDetected()), Qt::UniqueConnection);
+   QObject::connect(&game_, SIGNAL(insufficientMaterialDetected()), this, SLOT(insufficientMaterialDetected()), Qt::UniqueConnection);
 }
 
 void GameSession::disconnectGame()
@@ -390,6 +506,7 @@ void GameSession::disconnectGame()
    QObject::connect(&game_, SIGNAL(stalemateDetected()), this, SLOT(stalemateDetected()));
    QObject::connect(&game_, SIGNAL(fiftyMovesDetected()), this, SLOT(fiftyMovesDetected()));
    QObject::connect(&game_, SIGNAL(repetitionDetected()), this, SLOT(repetitionDetected()));
+   QObject::disconnect(&game_, SIGNAL(insufficientMaterialDetected()), this, SLOT(insufficientMaterialDetected()));
 }
 
 void GameSession::verifyBothPlayersReady()
@@ -461,6 +578,14 @@ void GameSession::startGame()
       enableInGameCommands();
    }
    //
+   journal_.open(g_settings.lastGameJournalFile(), sessionInfo_);
+   //
+   if(g_settings.useOpeningBook() &&
+      (PolyglotBook::keysLoaded() || PolyglotBook::loadKeys(g_settings.polyglotKeysFile())))
+   {
+      book_.open(g_settings.openingBookFile());
+   }
+   //
    if(!game_.moves().empty())
    {
       if(g_settings.useRussianNotation())
@@ -516,6 +641,8 @@ void GameSession::endGame(GameSessionEndReason reason, ChessGameResult result)
    //
    sessionInfo_.moves = game_.moves();
    //
+   journal_.close();
+   //
    if(reason==reasonGameFinished)
    {
       g_localChessGui.showSessionMessage(g_msg("GameFinished"));
@@ -604,6 +731,7 @@ void GameSession::white_requestsTakeback()
       {
          game_.takebackOneFullMove();
          updateSessionInfo();
+         journalTakeback(nmoves);
          //
          g_localChessGui.dropLastFullMove();
          g_localChessGui.setInitialMoveCursorPos(prevCursorPos);
@@ -647,6 +775,7 @@ void GameSession::black_requestsTakeback()
       {
          game_.takebackOneFullMove();
          updateSessionInfo();
+         journalTakeback(nmoves);
          //
          g_localChessGui.dropLastFullMove();
          g_localChessGui.setInitialMoveCursorPos(prevCursorPos);
@@ -674,6 +803,16 @@ void GameSession::black_requestsAbort()
    }
 }
 
+void GameSession::white_restarted()
+{
+   resyncPlayer(whitePlayer_, pcWhite);
+}
+
+void GameSession::black_restarted()
+{
+   resyncPlayer(blackPlayer_, pcBlack);
+}
+
 void GameSession::enableInGameCommands()
 {
    g_commandOptionDefs.inGameOptions().enable(cmd_InGame_Takeback);
@@ -729,3 +868,31 @@ void GameSession::updateCapturedPieces()
             sessionInfo_.initialPosition,
             game_.position());
 }
+
+void GameSession::journalLastMove()
+{
+   journal_.appendMove(game_.lastMove(), sessionInfo_.profile.whiteClock,
+                       sessionInfo_.profile.blackClock);
+}
+
+void GameSession::journalTakeback(unsigned nMovesBefore)
+{
+   unsigned nMovesAfter = game_.moves().size();
+   if(nMovesBefore>nMovesAfter)
+   {
+      journal_.appendTakeback(nMovesBefore-nMovesAfter);
+   }
+}
+
+void GameSession::compactJournal()
+{
+   journal_.close();
+   //
+   if(game_.result()==resultNone && !game_.moves().empty())
+   {
+      // keep the journal if the session file could not be written
+      if(!sessionInfo_.saveToFile(g_settings.lastGameFile())) return;
+   }
+   //
+   GameJournal::remove(g_settings.lastGameJournalFile());
+}
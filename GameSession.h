@@ -3,6 +3,9 @@
 
 #include "ChessPlayer.h"
 #include "GameSessionInfo.h"
+#include "GameJournal.h"
+#include "PolyglotBook.h"
+#include "SyzygyTablebases.h"
 
 #include <QObject>
 #include <QTimer>
@@ -40,6 +43,9 @@ public:
 
    GameType type() const { return sessionInfo_.profile.type; }
 
+   void compactJournal(); // saves unfinished game to the session file and removes the journal
+                          // (called on clean program exit)
+
 signals:
    void end(GameSessionEndReason reason, ChessGameResult result,
             const QString& message);
@@ -53,6 +59,7 @@ private slots:
    void white_says(const QString& msg);
    void white_requestsTakeback();
    void white_requestsAbort();
+   void white_restarted();
 
    void black_isReady();
    void black_moves(const ChessMove& move);
@@ -62,8 +69,10 @@ private slots:
    void black_says(const QString& msg);
    void black_requestsTakeback();
    void black_requestsAbort();
+   void black_restarted();
 
    void getReadyTimeout();
+   void playBookMove();
 
    void clockUpdateTimer();
    void clockUpdateRequest();
@@ -72,6 +81,7 @@ private slots:
    void stalemateDetected();
    void fiftyMovesDetected();
    void repetitionDetected();
+   void insufficientMaterialDetected();
 
 private:
    void connectPlayers();
@@ -85,12 +95,17 @@ private:
    QString getResultMessage(GameSessionEndReason reason, ChessGameResult result);
 
    void requestMove(ChessPlayer *player);
+   bool requestBookMove(ChessPlayer *player); // plays a book move on behalf of the player, if there is one
+   bool adjudicateByTablebases(); // ends an engine game if the tablebases know its result (a human gets a hint)
+   void resyncPlayer(ChessPlayer *player, PieceColor color); // replays the game to a restarted player
    void outputLastMove();
    void updateClockDisplay();
    void updateCapturedPieces();
 
    void enableInGameCommands();
    void updateSessionInfo();
+   void journalLastMove();
+   void journalTakeback(unsigned nMovesBefore);
 
 private:
    ChessPlayer *whitePlayer_;
@@ -110,12 +125,19 @@ private:
    QTimer getReadyTimer_;
    QTimer clockUpdateTimer_;
    //
+   GameJournal journal_;
+   //
+   PolyglotBook book_;
+   ChessMove bookMove_; // book move waiting to be played
+   //
    bool whiteDrawOfferActive_;
    bool blackDrawOfferActive_;
    bool canDrawByRepetition_;
    //
    int clockRedrawInterval_; // sec
    //
+   TablebaseResult tablebaseHint_; // last tablebase result shown to the human player (for white)
+   //
    std::map<std::string, unsigned> positionOccurrences_; // for theefold repetition detection
 };
 
@@ -1,5 +1,6 @@
 #include "GameSessionInfo.h"
 #include "StringUtils.h"
+#include "BinaryGameFormat.h"
 #include <QFile>
 #include <QTextStream>
 #include <QTextCodec>
@@ -15,21 +16,50 @@ bool readIntLine(QTextStream& in, int& value)
    return ok;
 }
 
+const char cSessionFileSignature[] = "K3GS";
+const char cCollectionFileSignature[] = "K3GC";
+const int cSignatureLength = 4;
+const char cBinaryFormatVersion = 1;
+
+bool checkSignature(const QByteArray& data, const char *signature)
+{
+   return data.size()>cSignatureLength &&
+         data.startsWith(signature) &&
+         data[cSignatureLength]==cBinaryFormatVersion;
 }
 
-bool GameSessionInfo::saveToFile(const QString& fileName) const
+quint32 clockValue(int ms)
+{
+   return ms>0 ? (quint32)ms : 0;
+}
+
+}
+
+bool GameSessionInfo::importFromTextFile(const QString& fileName)
 {
    QFile file(fileName);
    //
-   if(!file.open(QIODevice::WriteOnly|QIODevice::Truncate))
+   if(!file.open(QIODevice::ReadOnly)) return false;
+   //
+   QTextStream in(&file);
+   in.setCodec(QTextCodec::codecForName("UTF-8"));
+   //
+   if(!readHeader(in)) return false;
+   //
+   moves.clear();
+   //
+   while(true)
    {
-      // could not create game session file
-      return false;
+      QString move_str = in.readLine();
+      if(move_str.isEmpty()) break;
+      moves.push_back(ChessMove::fromString(toStdString(move_str)));
    }
    //
-   QTextStream out(&file);
-   out.setCodec(QTextCodec::codecForName("UTF-8"));
-   //
+   return true;
+}
+
+void GameSessionInfo::writeHeader(QTextStream& out) const
+{
    out << (unsigned)profile.type << "\n";
    //
    out << (profile.whiteClock.untimed ? '0' : '1')
@@ -43,27 +73,10 @@ bool GameSessionInfo::saveToFile(const QString& fileName) const
    out << profile.blackClock.remainingTime << "\n";
    out << profile.blackClock.moveIncrement << "\n";
    out << initialPosition.toString().c_str() << "\n";
-   //
-   if(!moves.empty())
-   {
-      for(unsigned i=0; i<moves.size(); ++i)
-      {
-         out << moves[i].toString().c_str() << "\n";
-      }
-   }
-   //
-   return true;
 }
 
-bool GameSessionInfo::loadFromFile(const QString& fileName)
+bool GameSessionInfo::readHeader(QTextStream& in)
 {
-   QFile file(fileName);
-   //
-   if(!file.open(QIODevice::ReadOnly)) return false;
-   //
-   QTextStream in(&file);
-   in.setCodec(QTextCodec::codecForName("UTF-8"));
-   //
    int stype;
    if(!readIntLine(in, stype)) return false;
    profile.type = (GameType)stype;
@@ -87,13 +100,169 @@ bool GameSessionInfo::loadFromFile(const QString& fileName)
    //
    initialPosition.setChess960(toStdString(fen)!=cStandardInitialFen);
    //
-   moves.clear();
+   return true;
+}
+
+bool GameSessionInfo::saveToFile(const QString& fileName) const
+{
+   QByteArray record;
+   toBinary(record);
    //
-   while(true)
+   QByteArray data;
+   data.reserve(record.size()+16);
+   data.append(cSessionFileSignature, cSignatureLength);
+   data.append(cBinaryFormatVersion);
+   BinaryGameFormat::writeRecord(data, record);
+   //
+   QFile file(fileName);
+   if(!file.open(QIODevice::WriteOnly|QIODevice::Truncate)) return false;
+   return file.write(data)==data.size();
+}
+
+bool GameSessionInfo::loadFromFile(const QString& fileName)
+{
+   QFile file(fileName);
+   if(!file.open(QIODevice::ReadOnly)) return false;
+   //
+   QByteArray data = file.readAll();
+   file.close();
+   //
+   if(!data.startsWith(cSessionFileSignature))
    {
-      QString move_str = in.readLine();
-      if(move_str.isEmpty()) break;
-      moves.push_back(ChessMove::fromString(toStdString(move_str)));
+      // session files of previous versions are in text format
+      return importFromTextFile(fileName);
+   }
+   if(!checkSignature(data, cSessionFileSignature)) return false;
+   //
+   const char *p = data.constData() + cSignatureLength + 1;
+   const char *end = data.constData() + data.size();
+   const char *record = 0;
+   quint32 size = 0;
+   if(!BinaryGameFormat::readRecord(p, end, record, size)) return false;
+   //
+   return fromBinary(record, size);
+}
+
+void GameSessionInfo::toBinary(QByteArray& out) const
+{
+   using namespace BinaryGameFormat;
+   //
+   out.reserve(out.size() + 32 + moves.size()*2);
+   //
+   out.append((char)profile.type);
+   out.append((char)((profile.whiteClock.untimed ? 0 : 1) |
+                     (profile.blackClock.untimed ? 0 : 2)));
+   //
+   writeVarUint(out, clockValue(profile.whiteClock.initialTime));
+   writeVarUint(out, clockValue(profile.whiteClock.remainingTime));
+   writeVarUint(out, clockValue(profile.whiteClock.moveIncrement));
+   writeVarUint(out, clockValue(profile.blackClock.initialTime));
+   writeVarUint(out, clockValue(profile.blackClock.remainingTime));
+   writeVarUint(out, clockValue(profile.blackClock.moveIncrement));
+   //
+   writePosition(out, initialPosition);
+   //
+   writeVarUint(out, moves.size());
+   for(unsigned i=0; i<moves.size(); ++i)
+   {
+      writeUint16(out, packMove(moves[i]));
+   }
+}
+
+bool GameSessionInfo::fromBinary(const char *data, quint32 size)
+{
+   using namespace BinaryGameFormat;
+   //
+   const char *p = data;
+   const char *end = data + size;
+   //
+   if(end-p<2) return false;
+   profile.type = (GameType)*p++;
+   quint8 flags = (quint8)*p++;
+   profile.whiteClock.untimed = (flags & 1)==0;
+   profile.blackClock.untimed = (flags & 2)==0;
+   //
+   quint32 values[6];
+   for(unsigned i=0; i<6; ++i)
+   {
+      if(!readVarUint(p, end, values[i])) return false;
+   }
+   profile.whiteClock.initialTime = values[0];
+   profile.whiteClock.remainingTime = values[1];
+   profile.whiteClock.moveIncrement = values[2];
+   profile.blackClock.initialTime = values[3];
+   profile.blackClock.remainingTime = values[4];
+   profile.blackClock.moveIncrement = values[5];
+   //
+   if(!readPosition(p, end, initialPosition)) return false;
+   initialPosition.setChess960(initialPosition.toString()!=cStandardInitialFen);
+   //
+   quint32 nMoves = 0;
+   if(!readVarUint(p, end, nMoves)) return false;
+   if((quint32)(end-p)<nMoves*2) return false;
+   //
+   moves.resize(nMoves);
+   for(quint32 i=0; i<nMoves; ++i)
+   {
+      quint16 packed = 0;
+      readUint16(p, end, packed);
+      moves[i] = unpackMove(packed);
+   }
+   //
+   return true;
+}
+
+bool GameSessionInfo::saveCollection(const QString& fileName,
+                                     const std::vector<GameSessionInfo>& games)
+{
+   QByteArray data;
+   data.append(cCollectionFileSignature, cSignatureLength);
+   data.append(cBinaryFormatVersion);
+   BinaryGameFormat::writeVarUint(data, games.size());
+   //
+   QByteArray record;
+   for(unsigned i=0; i<games.size(); ++i)
+   {
+      record.clear();
+      games[i].toBinary(record);
+      BinaryGameFormat::writeRecord(data, record);
+   }
+   //
+   QFile file(fileName);
+   if(!file.open(QIODevice::WriteOnly|QIODevice::Truncate)) return false;
+   return file.write(data)==data.size();
+}
+
+bool GameSessionInfo::loadCollection(const QString& fileName,
+                                     std::vector<GameSessionInfo>& games)
+{
+   QFile file(fileName);
+   if(!file.open(QIODevice::ReadOnly)) return false;
+   //
+   // the whole file is read at once and parsed in memory,
+   // which is a lot faster than reading games one by one
+   QByteArray data = file.readAll();
+   file.close();
+   //
+   if(!checkSignature(data, cCollectionFileSignature)) return false;
+   //
+   const char *p = data.constData() + cSignatureLength + 1;
+   const char *end = data.constData() + data.size();
+   //
+   quint32 nGames = 0;
+   if(!BinaryGameFormat::readVarUint(p, end, nGames)) return false;
+   //
+   games.clear();
+   games.reserve(qMin(nGames, (quint32)(end-p)/8)); // don't trust a damaged count
+   //
+   for(quint32 i=0; i<nGames; ++i)
+   {
+      const char *record = 0;
+      quint32 size = 0;
+      if(!BinaryGameFormat::readRecord(p, end, record, size)) return false;
+      //
+      games.push_back(GameSessionInfo());
+      if(!games.back().fromBinary(record, size)) return false;
    }
    //
    return true;
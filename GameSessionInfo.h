@@ -5,14 +5,35 @@
 #include "GameProfile.h"
 #include "ChessMove.h"
 
+class QTextStream;
+class QByteArray;
+
 struct GameSessionInfo
 {
    ChessPosition initialPosition;
    GameProfile profile;
    std::vector<ChessMove> moves;
    //
-   bool saveToFile(const QString& fileName) const;
-   bool loadFromFile(const QString& fileName);
+   bool saveToFile(const QString& fileName) const;   // binary format
+   bool loadFromFile(const QString& fileName);       // binary or text format
+   //
+   // text format (one value per line) of earlier versions, only read
+   // as a fallback by loadFromFile()
+   bool importFromTextFile(const QString& fileName);
+   //
+   void toBinary(QByteArray& out) const;
+   bool fromBinary(const char *data, quint32 size);
+   //
+   // game collections (e.g. saved games archive) in a single binary file
+   static bool saveCollection(const QString& fileName,
+                              const std::vector<GameSessionInfo>& games);
+   static bool loadCollection(const QString& fileName,
+                              std::vector<GameSessionInfo>& games);
+   //
+   // game type, clocks and initial position (everything except moves),
+   // shared with GameJournal
+   void writeHeader(QTextStream& out) const;
+   bool readHeader(QTextStream& in);
 };
 
 #endif
@@ -7,15 +7,74 @@
 #include "GlobalStrings.h"
 #include "KeyMapper.h"
 #include "GameSessionInfo.h"
+#include "GameJournal.h"
+#include "PgnDatabase.h"
+#include "PgnImporter.h"
+#include "PositionHash.h"
+#include "PolyglotBook.h"
+#include "BookBuilder.h"
+#include "SyzygyTablebases.h"
 #include "StringUtils.h"
 
 #include <QFile>
 #include <QTextStream>
 #include <QTextCodec>
+#include <QStringList>
+#include <QDir>
+#include <QFileInfo>
+#include <QThread>
+
+namespace
+{
+
+// imports the PGN database into the game collection and indexes the
+// new collection, off the GUI thread (both take a pass over all games)
+class CollectionImporter : public QThread
+{
+public:
+   CollectionImporter(const QString& pgnFileName, const QString& collectionFileName) :
+      pgnFileName_(pgnFileName), collectionFileName_(collectionFileName), ok_(false) {}
+
+   void run()
+   {
+      PgnImporter importer;
+      ok_ = importer.importFile(pgnFileName_, collectionFileName_, stats_) && stats_.nGames>0;
+      //
+      // the position index is only valid for the previous collection file
+      if(ok_) PositionIndex::build(collectionFileName_);
+   }
+
+   bool ok() const { return ok_; }
+   const PgnImportStats& stats() const { return stats_; }
+
+private:
+   QString pgnFileName_;
+   QString collectionFileName_;
+   bool ok_;
+   PgnImportStats stats_;
+};
+
+// builds the position index of a collection which has none (or an outdated one)
+class PositionIndexBuilder : public QThread
+{
+public:
+   explicit PositionIndexBuilder(const QString& collectionFileName) :
+      collectionFileName_(collectionFileName) {}
+
+   void run()
+   {
+      PositionIndex::build(collectionFileName_);
+   }
+
+private:
+   QString collectionFileName_;
+};
+
+}
 
 GlobalUISession::GlobalUISession() :
    localHuman_(0), localEngine_(0), localHuman1_(0), localHuman2_(0),
-   gameSession_(0), keyRemapIdx_(-1), menuType_(menuNone)
+   gameSession_(0), keyRemapIdx_(-1), menuType_(menuNone), collectionWorker_(0), bookBuilder_(0)
 {
    initialize();
    //
@@ -32,6 +91,16 @@ GlobalUISession::GlobalUISession() :
 
 GlobalUISession::~GlobalUISession()
 {
+   if(collectionWorker_)
+   {
+      collectionWorker_->wait();
+      delete collectionWorker_;
+   }
+   if(bookBuilder_)
+   {
+      bookBuilder_->wait();
+      delete bookBuilder_;
+   }
    finalize();
 }
 
@@ -40,8 +109,8 @@ void GlobalUISession::initialize()
    localHuman_ = new ChessPlayer_LocalHuman(g_settings.playerName());
    localHuman1_ = new ChessPlayer_LocalHuman("P1");   // @@todo: ask player names via UI before game starts
    localHuman2_ = new ChessPlayer_LocalHuman("P2");
-   localEngine_ = new ChessPlayer_LocalEngine(g_settings.engineInfo(), g_settings.currentEngineProfile());
-   check960Support();
+   // local engine is created in asyncBegin(), after the board is shown
+   // (enumerating engines scans engine directories)
 }
 
 void GlobalUISession::begin()
@@ -58,6 +127,13 @@ void GlobalUISession::asyncBegin()
    QObject::disconnect(&beginDelayTimer_, SIGNAL(timeout()),
                        this, SLOT(asyncBegin()));
    //
+   if(!localEngine_)
+   {
+      localEngine_ = new ChessPlayer_LocalEngine(g_settings.engineInfo(), g_settings.currentEngineProfile());
+      check960Support();
+      Singletons::logStartupPhase("engine");
+   }
+   //
    if(g_keyMapper.fileNotFound())
    {
       beginKeyRemapping();
@@ -177,6 +253,20 @@ void GlobalUISession::userChoice(int id)
             showNewGameMenu();
          }
          break;
+      case cmd_ExtMenu_OpenGame:
+         if(!openDatabaseGame())
+         {
+            showNewGameMenu();
+         }
+         break;
+      case cmd_ExtMenu_ImportGames:
+         importDatabaseGames();
+         showNewGameMenu();
+         break;
+      case cmd_ExtMenu_BuildBook:
+         buildOpeningBook();
+         showNewGameMenu();
+         break;
       case cmd_ExtMenu_Quit:
          requestExit();
          break;
@@ -356,6 +446,35 @@ void GlobalUISession::keyPressed(Qt::Key key, Qt::KeyboardModifiers modifiers)
             g_settings.setShowCapturedPieces(!g_settings.showCapturedPieces());
             g_localChessGui.updateShowCaptured();
             break;
+         case Qt::Key_E:
+            if(modifiers & Qt::AltModifier)
+            {
+               // Alt+E shows explorer stats for the current position,
+               // Shift+Alt+E turns the explorer off
+               if(modifiers & Qt::ShiftModifier)
+                  g_settings.setShowOpeningExplorer(false);
+               else
+                  g_localChessGui.showOpeningStats(gameSession_ ? gameSession_->game().position() : initialPosition_);
+            }
+            break;
+         case Qt::Key_B:
+            if(modifiers & Qt::AltModifier)
+            {
+               showBookMoves();
+            }
+            break;
+         case Qt::Key_Z:
+            if(modifiers & Qt::AltModifier)
+            {
+               showTablebaseResult();
+            }
+            break;
+         case Qt::Key_P:
+            if(modifiers & Qt::AltModifier)
+            {
+               findPositionInGames();
+            }
+            break;
          case Qt::Key_N:
             if(modifiers & Qt::AltModifier)
             {
@@ -420,7 +539,14 @@ void GlobalUISession::nextKeyRemapPrompt()
 bool GlobalUISession::restoreLastGame()
 {
    GameSessionInfo sessionInfo;
-   if(!sessionInfo.loadFromFile(g_settings.lastGameFile())) return false;
+   //
+   // the journal is only left behind if the program did not exit cleanly,
+   // in which case it is more recent than the session file
+   if(!GameJournal::load(g_settings.lastGameJournalFile(), sessionInfo) ||
+         sessionInfo.moves.empty())
+   {
+      if(!sessionInfo.loadFromFile(g_settings.lastGameFile())) return false;
+   }
    playGame(sessionInfo);
    return true;
 }
@@ -429,6 +555,262 @@ void GlobalUISession::clearLastGame()
 {
    QDir dir(extractFolderPath(g_settings.lastGameFile()));
    dir.remove(g_settings.lastGameFile());
+   GameJournal::remove(g_settings.lastGameJournalFile());
+}
+
+bool GlobalUISession::openDatabaseGame()
+{
+   // the index is cached on disk, so opening is cheap unless the file has changed
+   // (the file is not kept open, games are appended to it after each game)
+   PgnDatabase pgnDatabase;
+   if(!pgnDatabase.open(g_settings.pgnDatabaseFile()) ||
+         pgnDatabase.gameCount()==0)
+   {
+      g_localChessGui.showSessionMessage(g_msg("NoGamesInDatabase").arg(g_settings.pgnDatabaseFile()));
+      return false;
+   }
+   //
+   int number = 0;
+   if(!g_localChessGui.getGameNumber(g_msg("InputGameNumber").arg(pgnDatabase.gameCount()),
+                                     pgnDatabase.gameCount(), number)) return false;
+   //
+   GameSessionInfo sessionInfo;
+   if(!pgnDatabase.readGame(number-1, sessionInfo)) return false;
+   //
+   clearLastGame();
+   initialPosition_ = sessionInfo.initialPosition;
+   playGame(sessionInfo);
+   return true;
+}
+
+void GlobalUISession::importDatabaseGames()
+{
+   if(collectionWorker_)
+   {
+      g_localChessGui.showSessionMessage(g_msg("CollectionBusy"));
+      return;
+   }
+   //
+   // the collection and its index file are replaced by the worker
+   positionIndex_.close();
+   //
+   g_localChessGui.showSessionMessage(g_msg("ImportingGames").arg(g_settings.pgnDatabaseFile()));
+   collectionWorker_ = new CollectionImporter(g_settings.pgnDatabaseFile(), g_settings.gameCollectionFile());
+   QObject::connect(collectionWorker_, SIGNAL(finished()), this, SLOT(gamesImported()));
+   collectionWorker_->start(QThread::LowPriority);
+}
+
+void GlobalUISession::gamesImported()
+{
+   CollectionImporter *importer = static_cast<CollectionImporter *>(collectionWorker_);
+   collectionWorker_ = 0;
+   //
+   if(!importer->ok())
+   {
+      g_localChessGui.showSessionMessage(g_msg("NoGamesInDatabase").arg(g_settings.pgnDatabaseFile()));
+   }
+   else
+   {
+      const PgnImportStats& stats = importer->stats();
+      g_localChessGui.showSessionMessage(g_msg("GamesImported").arg(stats.nImported)
+                                         .arg(stats.nErrors).arg(stats.gamesPerSecond()));
+   }
+   delete importer;
+}
+
+void GlobalUISession::positionIndexBuilt()
+{
+   delete collectionWorker_;
+   collectionWorker_ = 0;
+   //
+   const QString& collectionFile = g_settings.gameCollectionFile();
+   if(!positionIndex_.open(collectionFile))
+   {
+      g_localChessGui.showSessionMessage(g_msg("NoGamesInDatabase").arg(collectionFile));
+      return;
+   }
+   findPositionInGames();
+}
+
+void GlobalUISession::findPositionInGames()
+{
+   if(collectionWorker_)
+   {
+      g_localChessGui.showSessionMessage(g_msg("CollectionBusy"));
+      return;
+   }
+   //
+   const QString& collectionFile = g_settings.gameCollectionFile();
+   //
+   if(!positionIndex_.isOpen() || positionIndex_.collectionFileName()!=collectionFile)
+   {
+      // the index is missing or outdated if the collection was replaced outside the program,
+      // it is built in a worker thread and the search is repeated when it is ready
+      if(!positionIndex_.open(collectionFile))
+      {
+         if(!QFileInfo(collectionFile).exists())
+         {
+            g_localChessGui.showSessionMessage(g_msg("NoGamesInDatabase").arg(collectionFile));
+            return;
+         }
+         g_localChessGui.showSessionMessage(g_msg("BuildingPositionIndex").arg(collectionFile));
+         collectionWorker_ = new PositionIndexBuilder(collectionFile);
+         QObject::connect(collectionWorker_, SIGNAL(finished()), this, SLOT(positionIndexBuilt()));
+         collectionWorker_->start(QThread::LowPriority);
+         return;
+      }
+   }
+   //
+   const ChessPosition& position = gameSession_ ? gameSession_->game().position() : initialPosition_;
+   //
+   const unsigned cMaxListedGames = 10;
+   std::vector<PositionIndexEntry> entries;
+   unsigned nGames = positionIndex_.find(positionHash(position), entries, cMaxListedGames);
+   if(nGames==0)
+   {
+      g_localChessGui.showSessionMessage(g_msg("PositionNotFound"));
+      return;
+   }
+   //
+   QStringList games;
+   for(unsigned i=0; i<entries.size(); ++i)
+   {
+      games << g_msg("GameAtMove").arg(entries[i].game+1).arg(entries[i].ply/2+1);
+   }
+   if(nGames>entries.size()) games << "...";
+   //
+   g_localChessGui.showSessionMessage(g_msg("PositionFound").arg(nGames).arg(games.join(", ")));
+}
+
+void GlobalUISession::showBookMoves()
+{
+   if(!PolyglotBook::keysLoaded() && !PolyglotBook::loadKeys(g_settings.polyglotKeysFile()))
+   {
+      g_localChessGui.showSessionMessage(g_msg("NoPolyglotKeys").arg(g_settings.polyglotKeysFile()));
+      return;
+   }
+   //
+   PolyglotBook book;
+   if(!book.open(g_settings.openingBookFile()))
+   {
+      g_localChessGui.showSessionMessage(g_msg("NoOpeningBook").arg(g_settings.openingBookFile()));
+      return;
+   }
+   //
+   std::vector<ChessMove> moves;
+   std::vector<unsigned> weights;
+   book.findMoves(gameSession_ ? gameSession_->game().position() : initialPosition_, moves, weights);
+   if(moves.empty())
+   {
+      g_localChessGui.showSessionMessage(g_msg("NoBookMoves"));
+      return;
+   }
+   //
+   unsigned total = 0;
+   for(unsigned i=0; i<weights.size(); ++i) total += weights[i];
+   //
+   QStringList list;
+   for(unsigned i=0; i<moves.size(); ++i)
+   {
+      list << QString("%1 (%2%)").arg(moves[i].toString().c_str())
+                                 .arg(total ? weights[i]*100/total : 0);
+   }
+   g_localChessGui.showSessionMessage(g_msg("BookMoves").arg(list.join(" ")));
+}
+
+void GlobalUISession::buildOpeningBook()
+{
+   if(bookBuilder_)
+   {
+      g_localChessGui.showSessionMessage(g_msg("BookBusy"));
+      return;
+   }
+   //
+   if(!PolyglotBook::keysLoaded() && !PolyglotBook::loadKeys(g_settings.polyglotKeysFile()))
+   {
+      g_localChessGui.showSessionMessage(g_msg("NoPolyglotKeys").arg(g_settings.polyglotKeysFile()));
+      return;
+   }
+   //
+   QStringList pgnFiles(g_settings.pgnDatabaseFile());
+   if(g_settings.pgnFilePath()!=g_settings.pgnDatabaseFile())
+   {
+      // games played in the program (the file may not exist yet)
+      pgnFiles << g_settings.pgnFilePath();
+   }
+   //
+   // parsing the games and sorting the records takes a while, so the
+   // book is built in a worker thread which reports its progress
+   bookBuilder_ = new BookBuildThread(pgnFiles, g_settings.openingBookFile());
+   QObject::connect(bookBuilder_, SIGNAL(readingFile(QString)), this, SLOT(bookReadingFile(QString)));
+   QObject::connect(bookBuilder_, SIGNAL(writingBook(QString)), this, SLOT(bookWriting(QString)));
+   QObject::connect(bookBuilder_, SIGNAL(finished()), this, SLOT(openingBookBuilt()));
+   bookBuilder_->start(QThread::LowPriority);
+}
+
+void GlobalUISession::bookReadingFile(const QString& pgnFileName)
+{
+   g_localChessGui.showSessionMessage(g_msg("BuildingOpeningBook").arg(pgnFileName));
+}
+
+void GlobalUISession::bookWriting(const QString& bookFileName)
+{
+   g_localChessGui.showSessionMessage(g_msg("WritingOpeningBook").arg(bookFileName));
+}
+
+void GlobalUISession::openingBookBuilt()
+{
+   BookBuildThread *builder = bookBuilder_;
+   bookBuilder_ = 0;
+   //
+   if(!builder->ok())
+   {
+      g_localChessGui.showSessionMessage(g_msg("NoGamesInDatabase").arg(g_settings.pgnDatabaseFile()));
+   }
+   else
+   {
+      const BookBuildStats& stats = builder->stats();
+      g_localChessGui.showSessionMessage(g_msg("BookBuilt").arg(g_settings.openingBookFile())
+                                         .arg(stats.nPositions).arg(stats.nGames));
+   }
+   delete builder;
+}
+
+void GlobalUISession::showTablebaseResult()
+{
+   if(!SyzygyTablebases::isCompiledIn())
+   {
+      g_localChessGui.showSessionMessage(g_msg("NoTablebaseSupport"));
+      return;
+   }
+   //
+   const ChessPosition& position = gameSession_ ? gameSession_->game().position() : initialPosition_;
+   //
+   ChessMove bestMove;
+   unsigned dtz = 0;
+   TablebaseResult result = SyzygyTablebases::probeRoot(position, bestMove, dtz);
+   if(result==tbUnknown)
+   {
+      g_localChessGui.showSessionMessage(g_msg("NoTablebaseResult"));
+      return;
+   }
+   //
+   QString resultText = g_msg("TablebaseDraw");
+   if(result!=tbDraw)
+   {
+      bool whiteWins = (result==tbWin)==(position.sideToMove()==pcWhite);
+      resultText = g_msg(whiteWins ? "TablebaseWhiteWins" : "TablebaseBlackWins");
+   }
+   //
+   if(bestMove.assigned())
+   {
+      g_localChessGui.showSessionMessage(g_msg("TablebaseResult").arg(resultText)
+                                         .arg(bestMove.toString().c_str()).arg(dtz));
+   }
+   else
+   {
+      g_localChessGui.showSessionMessage(resultText);
+   }
 }
 
 void GlobalUISession::requestExit()
@@ -439,12 +821,13 @@ void GlobalUISession::requestExit()
 
 void GlobalUISession::isExiting()
 {
-   if(gameSession_ && gameSession_->game().result()==resultNone
-         && !gameSession_->game().moves().empty())
+   if(gameSession_)
    {
-      // save game (will be restored and continued on next program start)
-      gameSession_->sessionInfo().saveToFile(g_settings.lastGameFile());
+      // save unfinished game (will be restored and continued on next program start)
+      gameSession_->compactJournal();
    }
+   //
+   g_settings.flush();
 }
 
 void GlobalUISession::check960Support()
@@ -5,12 +5,15 @@
 #include "CommandOptions.h"
 #include "GameProfile.h"
 #include "GameSession.h"
+#include "PositionIndex.h"
 #include "Singletons.h"
 
 #include <QTimer>
+#include <QThread>
 
 class ChessPlayer_LocalEngine;
 class ChessPlayer_LocalHuman;
+class BookBuildThread;
 
 enum MenuType { menuNone, menuNewGame, menuExt };
 
@@ -43,6 +46,12 @@ private slots:
 
    void isExiting();
 
+   void gamesImported();      // the collection workers have finished
+   void positionIndexBuilt();
+   void bookReadingFile(const QString& pgnFileName); // book builder progress
+   void bookWriting(const QString& bookFileName);
+   void openingBookBuilt();
+
 private:
    void initialize();
    void preGame();
@@ -62,6 +71,12 @@ private:
    void saveGameToPGN();
    bool restoreLastGame();
    void clearLastGame();
+   bool openDatabaseGame(); // lets user pick a game from the PGN database and replays it
+   void importDatabaseGames(); // converts the PGN database into the binary game collection (in a worker thread)
+   void findPositionInGames(); // lists collection games which reached the current position (the index is built in a worker thread if needed)
+   void showBookMoves(); // lists opening book moves for the current position
+   void buildOpeningBook(); // makes the opening book out of the PGN database and saved games (in a worker thread)
+   void showTablebaseResult(); // probes the endgame tablebases for the current position
 
    void check960Support();
 
@@ -77,6 +92,9 @@ private:
    MenuType menuType_;
    QTimer beginDelayTimer_;
    ChessPosition initialPosition_; // standard or 960 random (or last)
+   PositionIndex positionIndex_;   // opened on first position search
+   QThread *collectionWorker_;     // imports games into the collection or indexes it, if running
+   BookBuildThread *bookBuilder_;  // builds the opening book, if running
 };
 
 #endif
@@ -0,0 +1,9 @@
+include (K3Chess.pri)
+
+SOURCES -= main.cpp
+SOURCES += RenderBenchmark.cpp
+
+DESTDIR = ./bin
+TARGET = K3ChessBenchmark
+CONFIG += warn_on qt
+DEFINES += CONFIG_DESKTOP
@@ -29,7 +29,22 @@ SOURCES = ChessBoardView.cpp \
     Random.cpp\
     GameClockView.cpp \
     CapturedPiecesView.cpp \
-    ExtConsole.cpp
+    ExtConsole.cpp \
+    EngineTimeManager.cpp \
+    GameJournal.cpp \
+    BinaryGameFormat.cpp \
+    PgnDatabase.cpp \
+    PgnImporter.cpp \
+    PositionHash.cpp \
+    PositionIndex.cpp \
+    OpeningExplorer.cpp \
+    PolyglotBook.cpp \
+    BookBuilder.cpp \
+    SyzygyTablebases.cpp \
+    MoveCache.cpp \
+    RepaintScheduler.cpp \
+    PieceSpriteCache.cpp \
+    DiscoveryIndex.cpp
 
 
 HEADERS = ChessBoardView.h \
@@ -66,8 +81,34 @@ HEADERS = ChessBoardView.h \
     Random.h\
     GameClockView.h \
     CapturedPiecesView.h \
-    ExtConsole.h
+    ExtConsole.h \
+    EngineTimeManager.h \
+    GameJournal.h \
+    BinaryGameFormat.h \
+    PgnDatabase.h \
+    PgnImporter.h \
+    PositionHash.h \
+    PositionIndex.h \
+    OpeningExplorer.h \
+    PolyglotBook.h \
+    BookBuilder.h \
+    SyzygyTablebases.h \
+    MoveCache.h \
+    RepaintScheduler.h \
+    PieceSpriteCache.h \
+    DiscoveryIndex.h
 
 
+# Syzygy tablebase probing uses Fathom (https://github.com/jdart1/Fathom),
+# it is enabled when Fathom sources are found in ./fathom/src or in
+# qmake FATHOM_DIR=<Fathom src directory>, builds without it report
+# that there is no tablebase support
+isEmpty(FATHOM_DIR):exists($$PWD/fathom/src/tbprobe.c): FATHOM_DIR = $$PWD/fathom/src
+!isEmpty(FATHOM_DIR) {
+    DEFINES += CONFIG_SYZYGY
+    INCLUDEPATH += $$FATHOM_DIR
+    SOURCES += $$FATHOM_DIR/tbprobe.c
+}
+
 FORMS += \
     SettingsDialog.ui
@@ -4,12 +4,37 @@
 #include "GlobalStrings.h"
 #include "Settings.h"
 #include "SettingsDialog.h"
+#include "RepaintScheduler.h"
+#include "ChessGame.h"
 
 #include <QInputDialog>
 #include <QMessageBox>
+#include <QThread>
 
-LocalChessGui::LocalChessGui() : clockDisplay_(false)
+namespace
 {
+
+class OpeningExplorerBuilder : public QThread
+{
+public:
+   explicit OpeningExplorerBuilder(const QString& pgnFileName) :
+      pgnFileName_(pgnFileName) {}
+
+   void run()
+   {
+      OpeningExplorer::build(pgnFileName_);
+   }
+
+private:
+   QString pgnFileName_;
+};
+
+}
+
+LocalChessGui::LocalChessGui() : clockDisplay_(false), explorerBuilder_(0), statsPending_(false)
+{
+   g_repaintScheduler.setFullRefreshInterval(g_settings.fullRefreshInterval());
+   //
    mainWindow_ = new K3ChessMainWindow;
    //
    updateBoardStyle();
@@ -38,12 +63,24 @@ LocalChessGui::LocalChessGui() : clockDisplay_(false)
    QObject::connect(mainWindow_, SIGNAL(keyPressed(Qt::Key,Qt::KeyboardModifiers)), this, SIGNAL(keyPressed(Qt::Key,Qt::KeyboardModifiers)), Qt::UniqueConnection);
    QObject::connect(mainWindow_, SIGNAL(isClosing()), this, SIGNAL(isExiting()));
    //
-   QObject::connect(&g_settings, SIGNAL(boardStyleChanged()), this, SLOT(updateBoardStyle()), Qt::UniqueConnection);
+   QObject::connect(&g_settings, SIGNAL(piecesStyleChanged(QString)), this, SLOT(piecesStyleChanged()), Qt::UniqueConnection);
+   QObject::connect(&g_settings, SIGNAL(drawCoordinatesChanged(bool)), this, SLOT(drawCoordinatesChanged(bool)), Qt::UniqueConnection);
+   QObject::connect(&g_settings, SIGNAL(drawMoveArrowChanged(bool)), this, SLOT(drawMoveArrowChanged(bool)), Qt::UniqueConnection);
+   QObject::connect(&g_settings, SIGNAL(showMoveHintsChanged(bool)), this, SLOT(showMoveHintsChanged(bool)), Qt::UniqueConnection);
+   QObject::connect(&g_settings, SIGNAL(boardMarginsChanged(int)), this, SLOT(boardMarginsChanged()), Qt::UniqueConnection);
    QObject::connect(&g_settings, SIGNAL(inputSettingsChanged()), this, SLOT(updateInputMode()), Qt::UniqueConnection);
+   QObject::connect(&g_settings, SIGNAL(showOpeningExplorerChanged(bool)), this, SLOT(showOpeningExplorerChanged(bool)), Qt::UniqueConnection);
+   //
+   if(g_settings.showOpeningExplorer()) showOpeningExplorerChanged(true);
 }
 
 LocalChessGui::~LocalChessGui()
 {
+   if(explorerBuilder_)
+   {
+      explorerBuilder_->wait();
+      delete explorerBuilder_;
+   }
    delete mainWindow_;
 }
 
@@ -149,6 +186,14 @@ void LocalChessGui::updatePosition(const ChessPosition& position,
                                    const CoordPair& lastMove,
                                    const ChessMoveMap& possibleMoves)
 {
+   g_repaintScheduler.moveCompleted();
+   if(loggingEnabled())
+   {
+      logString(QString("Screen refreshes: %1 total; %2 full; %3 for the last move")
+                .arg(g_repaintScheduler.refreshCount()).arg(g_repaintScheduler.fullRefreshCount())
+                .arg(g_repaintScheduler.lastMoveRefreshCount()).toStdString());
+   }
+   //
    mainWindow_->boardView()->updatePosition(position, lastMove, possibleMoves);
 }
 
@@ -236,15 +281,45 @@ void LocalChessGui::showSettingsDialog()
 
 void LocalChessGui::updateBoardStyle()
 {
-   QImage pieces(g_settings.pieceImageFilePath());
-   mainWindow_->boardView()->setPiecesImage(pieces);
-   mainWindow_->capturedPieces()->setPiecesImage(pieces);
+   QString pieces = g_settings.pieceImageFilePath();
+   mainWindow_->boardView()->setPiecesStyle(pieces);
+   mainWindow_->capturedPieces()->setPiecesStyle(pieces);
    mainWindow_->boardView()->setDrawMoveArrow(g_settings.drawMoveArrow());
    mainWindow_->boardView()->setDrawCoords(g_settings.drawCoordinates());
    mainWindow_->boardView()->setShowMoveHints(g_settings.showMoveHints());
    mainWindow_->updateControlLayout();
 }
 
+void LocalChessGui::piecesStyleChanged()
+{
+   // only the pieces image has to be reloaded,
+   // other board settings have their own notifications
+   QString pieces = g_settings.pieceImageFilePath();
+   mainWindow_->boardView()->setPiecesStyle(pieces);
+   mainWindow_->capturedPieces()->setPiecesStyle(pieces);
+}
+
+void LocalChessGui::drawCoordinatesChanged(bool value)
+{
+   mainWindow_->boardView()->setDrawCoords(value);
+   mainWindow_->updateControlLayout(); // board padding depends on coordinates
+}
+
+void LocalChessGui::drawMoveArrowChanged(bool value)
+{
+   mainWindow_->boardView()->setDrawMoveArrow(value);
+}
+
+void LocalChessGui::showMoveHintsChanged(bool value)
+{
+   mainWindow_->boardView()->setShowMoveHints(value);
+}
+
+void LocalChessGui::boardMarginsChanged()
+{
+   mainWindow_->updateControlLayout();
+}
+
 void LocalChessGui::updateInputMode()
 {
    mainWindow_->boardView()->setDirectCoordinateInput(g_settings.coordinateMoveInput());
@@ -306,6 +381,105 @@ void LocalChessGui::updateShowCaptured()
    }
 }
 
+void LocalChessGui::showOpeningExplorerChanged(bool value)
+{
+   if(!value)
+   {
+      explorer_.close();
+      statsPending_ = false;
+      return;
+   }
+   //
+   if(explorerBuilder_) return; // already being built
+   //
+   // the explorer file is built once for every new version of the PGN file,
+   // in a worker thread (it takes a pass over the whole database)
+   const QString& pgnFile = g_settings.pgnDatabaseFile();
+   if(!explorer_.open(pgnFile))
+   {
+      showSessionMessage(g_msg("BuildingOpeningExplorer").arg(pgnFile));
+      explorerBuilder_ = new OpeningExplorerBuilder(pgnFile);
+      QObject::connect(explorerBuilder_, SIGNAL(finished()), this, SLOT(openingExplorerBuilt()));
+      explorerBuilder_->start(QThread::LowPriority);
+   }
+}
+
+void LocalChessGui::openingExplorerBuilt()
+{
+   delete explorerBuilder_;
+   explorerBuilder_ = 0;
+   //
+   if(!g_settings.showOpeningExplorer()) return; // turned off meanwhile
+   //
+   const QString& pgnFile = g_settings.pgnDatabaseFile();
+   if(!explorer_.open(pgnFile))
+   {
+      statsPending_ = false;
+      showSessionMessage(g_msg("NoGamesInDatabase").arg(pgnFile));
+      return;
+   }
+   //
+   if(statsPending_)
+   {
+      statsPending_ = false;
+      showOpeningStats(pendingStatsPosition_);
+   }
+}
+
+void LocalChessGui::showOpeningStats(const ChessPosition& position)
+{
+   if(!g_settings.showOpeningExplorer())
+   {
+      g_settings.setShowOpeningExplorer(true); // opens or starts building the explorer
+   }
+   //
+   if(!explorer_.isOpen())
+   {
+      if(explorerBuilder_)
+      {
+         pendingStatsPosition_ = position;
+         statsPending_ = true;
+      }
+      return;
+   }
+   //
+   std::vector<OpeningMoveStats> moves;
+   explorer_.lookup(position, moves);
+   if(moves.empty())
+   {
+      showSessionMessage(g_msg("NoOpeningStats"));
+      return;
+   }
+   //
+   // a single line with the most popular moves
+   const unsigned cMaxShownMoves = 5;
+   QString summary;
+   summary.reserve(160);
+   for(unsigned i=0; i<moves.size() && i<cMaxShownMoves; ++i)
+   {
+      const OpeningMoveStats& s = moves[i];
+      unsigned nResults = s.whiteWins + s.draws + s.blackWins;
+      unsigned nTotal = nResults ? nResults : 1;
+      if(!summary.isEmpty()) summary.append("  ");
+      summary.append(g_msg("OpeningStats")
+                     .arg(s.chessMove().toString().c_str())
+                     .arg(s.games)
+                     .arg(s.whiteWins*100/nTotal)
+                     .arg(s.draws*100/nTotal)
+                     .arg(s.blackWins*100/nTotal));
+   }
+   showSessionMessage(summary);
+}
+
+bool LocalChessGui::getGameNumber(const QString& message, int maxValue, int& value)
+{
+   bool ok;
+   int number = QInputDialog::getInt(mainWindow_, "K3Chess", message,
+                                     maxValue, 1, maxValue, 1, &ok);
+   if(ok) value = number;
+   return ok;
+}
+
 bool LocalChessGui::getInitialPosition(const QString &message, ChessPosition& position)
 {
    bool ok;
@@ -5,8 +5,10 @@
 #include "CommandOptions.h"
 #include "Singletons.h"
 #include "GameProfile.h"
+#include "OpeningExplorer.h"
 
 class K3ChessMainWindow;
+class QThread;
 
 class LocalChessGui : public QObject
 {
@@ -50,8 +52,10 @@ public:
    void switchToCommandView();
    void updateShowClock();
    void updateShowCaptured();
+   void showOpeningStats(const ChessPosition& position); // summary line from the opening explorer (turned on if it is off)
 
    //
+   bool getGameNumber(const QString& message, int maxValue, int& value);
    bool getInitialPosition(const QString &message, ChessPosition& position);
 
 signals:
@@ -64,6 +68,13 @@ signals:
 private slots:
    void updateBoardStyle();
    void updateInputMode();
+   void piecesStyleChanged();
+   void drawCoordinatesChanged(bool value);
+   void drawMoveArrowChanged(bool value);
+   void showMoveHintsChanged(bool value);
+   void boardMarginsChanged();
+   void showOpeningExplorerChanged(bool value);
+   void openingExplorerBuilt();
 
 private:
    void prepareCommandOptions();
@@ -71,6 +82,10 @@ private:
 private:
    K3ChessMainWindow *mainWindow_;
    bool clockDisplay_;
+   OpeningExplorer explorer_;
+   QThread *explorerBuilder_;       // builds an outdated explorer file in the background
+   ChessPosition pendingStatsPosition_; // stats requested while the explorer was being built
+   bool statsPending_;
 };
 
 #endif
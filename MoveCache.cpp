@@ -0,0 +1,92 @@
+#include "MoveCache.h"
+#include "PositionHash.h"
+#include "ChessRules.h"
+
+namespace
+{
+
+const unsigned cDefaultCapacity = 256;
+
+// castling moves differ in chess960, positions must not share an entry
+const quint64 cChess960Salt = Q_UINT64_C(0x3936304368657373); // "960Chess"
+
+}
+
+MoveCache::MoveCache() : capacity_(cDefaultCapacity), hits_(0), misses_(0)
+{
+}
+
+MoveCache::~MoveCache()
+{
+}
+
+void MoveCache::findPossibleMoves(const ChessPosition& position, ChessMoveMap& moves)
+{
+   quint64 key = positionHash(position);
+   if(position.isChess960()) key ^= cChess960Salt;
+   //
+   {
+      QMutexLocker lock(&mutex_);
+      std::map<quint64, EntryList::iterator>::iterator it = index_.find(key);
+      if(it!=index_.end())
+      {
+         entries_.splice(entries_.begin(), entries_, it->second);
+         moves = it->second->second;
+         ++hits_;
+         return;
+      }
+      ++misses_;
+   }
+   //
+   // moves are generated outside of the lock, other threads need not wait
+   g_chessRules.findPossibleMoves(position, moves);
+   //
+   QMutexLocker lock(&mutex_);
+   if(capacity_==0 || index_.find(key)!=index_.end()) return;
+   entries_.push_front(Entry(key, moves));
+   index_[key] = entries_.begin();
+   trim();
+}
+
+void MoveCache::setCapacity(unsigned capacity)
+{
+   QMutexLocker lock(&mutex_);
+   capacity_ = capacity;
+   trim();
+}
+
+unsigned MoveCache::capacity() const
+{
+   QMutexLocker lock(&mutex_);
+   return capacity_;
+}
+
+void MoveCache::clear()
+{
+   QMutexLocker lock(&mutex_);
+   entries_.clear();
+   index_.clear();
+   hits_ = 0;
+   misses_ = 0;
+}
+
+unsigned MoveCache::hits() const
+{
+   QMutexLocker lock(&mutex_);
+   return hits_;
+}
+
+unsigned MoveCache::misses() const
+{
+   QMutexLocker lock(&mutex_);
+   return misses_;
+}
+
+void MoveCache::trim()
+{
+   while(index_.size()>capacity_)
+   {
+      index_.erase(entries_.back().first);
+      entries_.pop_back();
+   }
+}
@@ -0,0 +1,53 @@
+#ifndef __MoveCache_h
+#define __MoveCache_h
+
+#include "Singletons.h"
+#include "ChessMoveMap.h"
+#include "ChessPosition.h"
+
+#include <QMutex>
+
+#include <list>
+#include <map>
+
+// MoveCache keeps legal moves of recently seen positions, so going back
+// to a position (takebacks, repetitions, browsing a game back and forth)
+// does not generate its moves again; positions are identified by their
+// Zobrist hash and the least recently used one is dropped when the cache
+// is full; the cache is shared by all users of g_moveCache and may be
+// used from several threads
+
+class MoveCache
+{
+   friend void Singletons::initialize();
+   friend void Singletons::finalize();
+   //
+   MoveCache();
+   ~MoveCache();
+
+public:
+   void findPossibleMoves(const ChessPosition& position, ChessMoveMap& moves);
+   //
+   void setCapacity(unsigned capacity); // number of positions
+   unsigned capacity() const;
+   void clear();
+   //
+   unsigned hits() const;
+   unsigned misses() const;
+
+private:
+   typedef std::pair<quint64, ChessMoveMap> Entry;
+   typedef std::list<Entry> EntryList;
+   //
+   void trim();
+
+private:
+   mutable QMutex mutex_;
+   unsigned capacity_;
+   EntryList entries_; // most recently used first
+   std::map<quint64, EntryList::iterator> index_;
+   unsigned hits_;
+   unsigned misses_;
+};
+
+#endif
@@ -1,32 +1,27 @@
 #include "MoveListView.h"
+#include "RepaintScheduler.h"
 #include <QResizeEvent>
-#include <QTextCursor>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QScrollBar>
 #include <assert.h>
 
 namespace
 {
 
-QString getMoveString(unsigned idx, const QString& move)
-{
-   static const QString cWhiteMove = "%1. %2";
-   //
-   if((idx%2)==0)
-   {
-      return cWhiteMove.arg(QString::number(idx/2+1), move);
-   }
-   else
-   {
-      return move;
-   }
-}
+const int cMargin = 4;
+const char *cNarrowestMove = "XXXXX"; // column width before wider moves are added
 
 }
 
 MoveListView::MoveListView(QWidget *parent) :
-   QPlainTextEdit(parent)
+   QAbstractScrollArea(parent), currentMove_(-1),
+   lineHeight_(1), spaceWidth_(0), widestMove_(0),
+   numberWidth_(0), columnWidth_(1), movesPerRow_(1)
 {
-   setReadOnly(true);
-   setWordWrapMode(QTextOption::ManualWrap);
+   verticalScrollBar()->setSingleStep(1);
+   measureFont();
+   updateLayout();
 }
 
 void MoveListView::addMove(const QString& move)
@@ -37,119 +32,243 @@ void MoveListView::addMove(const QString& move)
       return;
    }
    //
-   QString s = getMoveString(moves_.size(), move);
-   //
-   moves_.push_back(s);
-   //
-   regenerateLines();
+   unsigned first = moveCount();
+   appendMove(move);
+   movesChanged(first);
 }
 
 void MoveListView::addMoves(const QStringList& moves)
 {
    if(!moves.isEmpty())
    {
+      unsigned first = moveCount();
       foreach(QString move, moves)
       {
-         QString s = getMoveString(moves_.size(), move);
-         moves_.push_back(s);
+         appendMove(move);
       }
-      regenerateLines();
+      movesChanged(first);
+   }
+}
+
+void MoveListView::updateMoves(const QStringList &moves)
+{
+   clearMoves();
+   addMoves(moves);
+}
+
+void MoveListView::dropMoves(unsigned count)
+{
+   if(count>=moveCount())
+      clearMoves();
+   else
+   {
+      unsigned n = moveCount()-count;
+      moveText_.truncate(moveEnds_[n-1]);
+      moveEnds_.resize(n);
+      if(currentMove_>=(int)n) currentMove_ = -1;
+      //
+      movesChanged(n);
    }
 }
 
 void MoveListView::clearMoves()
 {
-   moves_.clear();
-   clear();
+   moveText_.clear();
+   moveEnds_.clear();
+   currentMove_ = -1;
+   //
+   updateLayout();
+   verticalScrollBar()->setValue(0);
+   g_repaintScheduler.schedule(viewport());
 }
 
-void MoveListView::resizeEvent(QResizeEvent*)
+unsigned MoveListView::moveCount() const
 {
-   regenerateLines();
+   return moveEnds_.size();
 }
 
-void MoveListView::regenerateLines()
+QString MoveListView::move(unsigned idx) const
 {
-   QString text;
-   text.reserve(2048);
+   assert(idx<moveEnds_.size());
    //
-   lastLine_.clear();
+   int begin = idx ? moveEnds_[idx-1] : 0;
+   return moveText_.mid(begin, moveEnds_[idx]-begin);
+}
+
+void MoveListView::setCurrentMove(int idx)
+{
+   if(idx>=(int)moveCount()) idx = -1;
+   if(idx==currentMove_) return;
    //
-   int halfMoveMargin = fontMetrics().width("XX. XXXXX");
+   if(currentMove_>=0) g_repaintScheduler.schedule(viewport(), cellRect(currentMove_));
+   currentMove_ = idx;
+   if(currentMove_>=0)
+   {
+      scrollToMove(currentMove_);
+      g_repaintScheduler.schedule(viewport(), cellRect(currentMove_));
+   }
+}
+
+void MoveListView::scrollToMove(unsigned idx)
+{
+   QScrollBar *scrollBar = verticalScrollBar();
+   int row = rowOf(idx);
    //
-   for(unsigned i=0; i<moves_.size(); ++i)
+   if(row<scrollBar->value())
+   {
+      scrollBar->setValue(row);
+   }
+   else if(row>=scrollBar->value()+scrollBar->pageStep())
    {
-      bool isWhiteMove = (i%2)==0;
+      scrollBar->setValue(row-scrollBar->pageStep()+1);
+   }
+}
+
+void MoveListView::paintEvent(QPaintEvent *event)
+{
+   QPainter painter(viewport());
+   painter.setFont(font());
+   //
+   const QRect& clipRect = event->rect();
+   //
+   // visible rows intersecting the clip rect only
+   int firstRow = verticalScrollBar()->value() + qMax(0, (clipRect.top()-cMargin)/lineHeight_);
+   int lastRow = verticalScrollBar()->value() + (clipRect.bottom()-cMargin)/lineHeight_;
+   //
+   unsigned first = firstRow*movesPerRow_*2;
+   unsigned last = qMin((unsigned)(lastRow+1)*movesPerRow_*2, moveCount());
+   //
+   for(unsigned idx=first; idx<last; ++idx)
+   {
+      QRect rect = cellRect(idx);
       //
-      QString line;
-      line.reserve(128);
-      if(!lastLine_.isEmpty())
+      if((idx%2)==0)
       {
-         line.append(lastLine_);
-         line.append(' ');
+         QRect numberRect(rect.left()-numberWidth_, rect.top(), numberWidth_-spaceWidth_, rect.height());
+         painter.setPen(palette().color(QPalette::Text));
+         painter.drawText(numberRect, Qt::AlignRight|Qt::AlignVCenter,
+                          QString::number(idx/2+1) + '.');
       }
       //
-      line.append(moves_[i]);
-      //
-      int maxWidth = isWhiteMove ? rect().width()-halfMoveMargin : rect().width();
-      //
-      if(fontMetrics().width(line)>maxWidth)
+      if((int)idx==currentMove_)
       {
-         if(lastLine_.isEmpty())
-         {
-            text.append(line);
-            text.append('\n');
-         }
-         else
-         {
-            if(isWhiteMove)
-            {
-               text.append(lastLine_);
-               lastLine_ = moves_[i];
-            }
-            else
-            {
-               text.append(lastLine_.left(lastLine_.length()-moves_[i-1].length()));
-               lastLine_ = moves_[i-1];
-               lastLine_.append(' ');
-               lastLine_.append(moves_[i]);
-            }
-            text.append('\n');
-         }
+         painter.fillRect(rect, palette().highlight());
+         painter.setPen(palette().color(QPalette::HighlightedText));
       }
       else
       {
-         lastLine_ = line;
+         painter.setPen(palette().color(QPalette::Text));
       }
+      painter.drawText(rect, Qt::AlignLeft|Qt::AlignVCenter, move(idx));
    }
+}
+
+void MoveListView::resizeEvent(QResizeEvent *event)
+{
+   QAbstractScrollArea::resizeEvent(event);
    //
-   if(!lastLine_.isEmpty())
+   updateLayout();
+   g_repaintScheduler.schedule(viewport());
+   //
+   if(moveCount())
    {
-      text.append(lastLine_);
+      scrollToMove(currentMove_>=0 ? currentMove_ : moveCount()-1);
    }
+}
+
+void MoveListView::changeEvent(QEvent *event)
+{
+   QAbstractScrollArea::changeEvent(event);
    //
-   setPlainText(text);
-   moveCursor(QTextCursor::End);
-   ensureCursorVisible();
+   if(event->type()==QEvent::FontChange)
+   {
+      measureFont();
+      updateLayout();
+      g_repaintScheduler.schedule(viewport());
+   }
 }
 
-void MoveListView::dropMoves(unsigned count)
+void MoveListView::scrollContentsBy(int, int)
 {
-   if(count>=moves_.size())
-      clearMoves();
+   g_repaintScheduler.schedule(viewport());
+}
+
+void MoveListView::appendMove(const QString& move)
+{
+   moveText_.append(move);
+   moveEnds_.push_back(moveText_.length());
+   widestMove_ = qMax(widestMove_, fontMetrics().width(move));
+}
+
+void MoveListView::movesChanged(unsigned firstIdx)
+{
+   if(updateLayout())
+   {
+      g_repaintScheduler.schedule(viewport());
+   }
    else
    {
-      while(count--)
-      {
-         moves_.removeLast();
-      }
-      //
-      regenerateLines();
+      // rows from the first changed move down
+      int top = cMargin + (rowOf(firstIdx)-verticalScrollBar()->value())*lineHeight_;
+      QRect rect = viewport()->rect();
+      rect.setTop(qMax(top, 0));
+      if(!rect.isEmpty()) g_repaintScheduler.schedule(viewport(), rect);
+   }
+   //
+   if(moveCount())
+   {
+      scrollToMove(moveCount()-1);
    }
 }
 
-void MoveListView::updateMoves(const QStringList &moves)
+void MoveListView::measureFont()
 {
-   moves_.clear();
-   addMoves(moves);
+   lineHeight_ = qMax(fontMetrics().lineSpacing(), 1);
+   spaceWidth_ = fontMetrics().width(' ');
+   //
+   // all moves are measured again only when the font changes
+   widestMove_ = fontMetrics().width(cNarrowestMove);
+   for(unsigned i=0; i<moveCount(); ++i)
+   {
+      widestMove_ = qMax(widestMove_, fontMetrics().width(move(i)));
+   }
+}
+
+bool MoveListView::updateLayout()
+{
+   int oldColumnWidth = columnWidth_;
+   int oldMovesPerRow = movesPerRow_;
+   int oldNumberWidth = numberWidth_;
+   //
+   QString lastNumber = QString::number(moveCount()/2+1);
+   numberWidth_ = fontMetrics().width(QString(lastNumber.length(), '0') + ". ");
+   columnWidth_ = numberWidth_ + 2*(widestMove_+spaceWidth_) + spaceWidth_;
+   movesPerRow_ = qMax(1, (viewport()->width()-2*cMargin)/columnWidth_);
+   //
+   int visibleRows = qMax(1, (viewport()->height()-2*cMargin)/lineHeight_);
+   verticalScrollBar()->setPageStep(visibleRows);
+   verticalScrollBar()->setRange(0, qMax(0, rowCount()-visibleRows));
+   //
+   return columnWidth_!=oldColumnWidth || movesPerRow_!=oldMovesPerRow ||
+          numberWidth_!=oldNumberWidth;
+}
+
+int MoveListView::rowOf(unsigned idx) const
+{
+   return idx/2/movesPerRow_;
+}
+
+int MoveListView::rowCount() const
+{
+   return moveCount() ? rowOf(moveCount()-1)+1 : 0;
+}
+
+QRect MoveListView::cellRect(unsigned idx) const
+{
+   unsigned fullMove = idx/2;
+   int row = fullMove/movesPerRow_ - verticalScrollBar()->value();
+   int col = fullMove%movesPerRow_;
+   //
+   return QRect(cMargin + col*columnWidth_ + numberWidth_ + (idx%2)*(widestMove_+spaceWidth_),
+                cMargin + row*lineHeight_, widestMove_, lineHeight_);
 }
@@ -1,10 +1,20 @@
 #ifndef MOVELISTVIEW_H
 #define MOVELISTVIEW_H
 
-#include <QPlainTextEdit>
+#include <QAbstractScrollArea>
 #include <QString>
+#include <QStringList>
 
-class MoveListView : public QPlainTextEdit
+#include <vector>
+
+// MoveListView shows game moves in a grid of full moves ("12. Nf3 Nc6"),
+// the row and column of a move follow from its number: there is no
+// per-line layout data, only visible rows are painted and any move is
+// found (and scrolled to) in constant time; moves are stored packed in
+// a single string, so long games and browsing database games keep the
+// memory use low
+
+class MoveListView : public QAbstractScrollArea
 {
    Q_OBJECT
 public:
@@ -16,15 +26,37 @@ public:
    void dropMoves(unsigned count);
    void clearMoves();
 
+   unsigned moveCount() const;
+   QString move(unsigned idx) const;
+
+   void setCurrentMove(int idx);    // highlights the move (-1 for none) and scrolls to it
+   void scrollToMove(unsigned idx);
+
 protected:
+   virtual void paintEvent(QPaintEvent *);
    virtual void resizeEvent(QResizeEvent *);
+   virtual void changeEvent(QEvent *);
+   virtual void scrollContentsBy(int dx, int dy);
 
 private:
-   void regenerateLines();
+   void appendMove(const QString& move);
+   void movesChanged(unsigned firstIdx); // repaints from the move on and scrolls to the last one
+   void measureFont();
+   bool updateLayout();                  // returns true if the grid has changed
+   int rowOf(unsigned idx) const;
+   int rowCount() const;
+   QRect cellRect(unsigned idx) const;  // in viewport coordinates
 
 private:
-   QString lastLine_;
-   QStringList moves_;
+   QString moveText_;              // all moves one after another
+   std::vector<quint32> moveEnds_; // end of each move in moveText_
+   int currentMove_;
+   int lineHeight_;
+   int spaceWidth_;
+   int widestMove_;   // widest move added so far
+   int numberWidth_;  // move number column
+   int columnWidth_;  // full move column
+   int movesPerRow_;  // full moves
 };
 
 #endif // MOVELISTVIEW_H
@@ -53,6 +53,45 @@ inline bool advanceCoord(ChessCoord& coord, const ChessPosition& position)
       return false;
 }
 
+// number of advanceCoord() steps needed to get from 'start' to 'coord'
+inline unsigned traversalDistance(ChessCoord start, ChessCoord coord, const ChessPosition& position)
+{
+   int n = position.maxRow()*position.maxCol();
+   int d = (coord.row-start.row)*position.maxCol() + (coord.col-start.col);
+   if(position.sideToMove()==pcBlack) d = -d;
+   return (d+n)%n;
+}
+
+// finds the first piece of the given type (any type if ptNone) of the side to move
+// that has moves, in advanceCoord() order starting from 'start' (inclusive);
+// only piece lists of the position are visited, not the whole board
+ChessCoord findNearestMovablePiece(const ChessPosition& position, const ChessMoveMap& moves,
+                                   ChessCoord start, PieceType pt)
+{
+   ChessCoord result;
+   unsigned minDistance = position.maxRow()*position.maxCol();
+   //
+   PieceColor color = position.sideToMove();
+   PieceType first = pt==ptNone ? ptFirst : pt;
+   PieceType last = pt==ptNone ? ptLast : pt;
+   //
+   for(PieceType type=first; type<=last; ++type)
+   {
+      for(unsigned i=0; i<position.pieceCount(color, type); ++i)
+      {
+         ChessCoord c = position.pieceCoord(color, type, i);
+         if(!moves.hasMovesFrom(c)) continue;
+         unsigned d = traversalDistance(start, c, position);
+         if(d<minDistance)
+         {
+            minDistance = d;
+            result = c;
+         }
+      }
+   }
+   return result;
+}
+
 ChessMoveMap::const_iterator findMove(
    const std::pair<ChessMoveMap::const_iterator,
                    ChessMoveMap::const_iterator>& range,
@@ -204,42 +243,17 @@ ChessCoord getNextPieceByType(const ChessPosition& position,
    //
    if(pt==ptNone) return coord;
    //
-   ChessPiece p(pt|position.sideToMove());
-   //
    ChessCoord c(coord);
    //
-   if(position.cell(coord)==p)
+   if(position.cell(coord)==ChessPiece(pt|position.sideToMove()))
       advanceCoord(c, position);
    //
-   unsigned ntrav = 0, ntravmax = position.maxRow()*position.maxCol();
-   while(true)
-   {
-      if(ntrav==ntravmax)
-      {
-         if(p!=ChessPiece())
-         {
-            p = ChessPiece();
-            ntrav = 0;
-         }
-         else
-            break;
-      }
-      //
-      ChessPiece p2 = position.cell(c);
-      if(moves.hasMovesFrom(c) &&
-         ((p!=ChessPiece() && p2==p) ||
-          (p==ChessPiece() && p2.type()!=ptNone &&
-           p2.color()==position.sideToMove())))
-      {
-         return c;
-      }
-      //
-      advanceCoord(c, position);
-      //
-      ++ntrav;
-   }
+   // prefer pieces of the requested type, then any piece that can move
+   ChessCoord found = findNearestMovablePiece(position, moves, c, pt);
+   if(found==ChessCoord())
+      found = findNearestMovablePiece(position, moves, c, ptNone);
    //
-   return coord;
+   return found==ChessCoord() ? coord : found;
 }
 
 template <class TargetCondition>
@@ -0,0 +1,244 @@
+#include "OpeningExplorer.h"
+#include "PositionHash.h"
+#include "PgnDatabase.h"
+#include "BinaryGameFormat.h"
+#include "ChessRules.h"
+#include "StringUtils.h"
+
+#include <QFileInfo>
+
+#include <algorithm>
+#include <string.h>
+
+namespace
+{
+
+const char cExplorerSignature[] = "K3OX";
+const quint32 cExplorerVersion = 2;
+const unsigned cMaxExplorerPly = 40; // opening stage only, keeps the file small
+
+enum GameResultCode { resultUnknown, resultWhiteWins, resultDraw, resultBlackWins };
+
+// fixed size header, entries follow it
+struct ExplorerHeader
+{
+   char signature[4];
+   quint32 version;
+   qint64 pgnSize;       // the file is valid only for the very same PGN file
+   qint64 pgnModified;   // ms since the epoch
+   quint32 count;
+   quint32 entrySize;
+   quint32 reserved;
+};
+
+// single move of a single game, aggregated into OpeningMoveStats after sorting
+struct MoveOccurrence
+{
+   quint64 hash;
+   quint16 move;
+   quint8 result;
+   //
+   bool operator<(const MoveOccurrence& m) const
+   {
+      return hash!=m.hash ? hash<m.hash : move<m.move;
+   }
+};
+
+bool fillHeader(ExplorerHeader& header, const QString& pgnFileName)
+{
+   QFileInfo info(pgnFileName);
+   if(!info.exists()) return false;
+   //
+   memset(&header, 0, sizeof(header));
+   memcpy(header.signature, cExplorerSignature, sizeof(header.signature));
+   header.version = cExplorerVersion;
+   header.pgnSize = info.size();
+   header.pgnModified = fileModificationTime(info);
+   header.entrySize = sizeof(OpeningMoveStats);
+   return true;
+}
+
+quint8 resultCode(const QString& result)
+{
+   if(result=="1-0") return resultWhiteWins;
+   if(result=="0-1") return resultBlackWins;
+   if(result=="1/2-1/2") return resultDraw;
+   return resultUnknown;
+}
+
+struct HashLess
+{
+   bool operator()(const OpeningMoveStats& e, quint64 hash) const { return e.hash<hash; }
+   bool operator()(quint64 hash, const OpeningMoveStats& e) const { return hash<e.hash; }
+};
+
+bool morePopular(const OpeningMoveStats& a, const OpeningMoveStats& b)
+{
+   return a.games>b.games;
+}
+
+}
+
+ChessMove OpeningMoveStats::chessMove() const
+{
+   return BinaryGameFormat::unpackMove(move);
+}
+
+OpeningExplorer::OpeningExplorer() : data_(0), entries_(0), count_(0)
+{
+}
+
+OpeningExplorer::~OpeningExplorer()
+{
+   close();
+}
+
+QString OpeningExplorer::explorerFileName(const QString& pgnFileName)
+{
+   return pgnFileName + ".exp";
+}
+
+bool OpeningExplorer::build(const QString& pgnFileName)
+{
+   ExplorerHeader header;
+   if(!fillHeader(header, pgnFileName)) return false;
+   //
+   PgnDatabase database;
+   if(!database.open(pgnFileName)) return false;
+   //
+   std::vector<MoveOccurrence> occurrences;
+   occurrences.reserve(database.gameCount()*cMaxExplorerPly);
+   //
+   GameSessionInfo info;
+   MoveOccurrence m;
+   for(unsigned i=0; i<database.gameCount(); ++i)
+   {
+      // moves are validated by the parser, a game with an illegal move
+      // contributes the moves before it
+      if(!database.readGame(i, info)) continue;
+      //
+      m.result = resultCode(database.entry(i).result);
+      ChessPosition position = info.initialPosition;
+      //
+      unsigned nPlies = qMin((unsigned)info.moves.size(), cMaxExplorerPly);
+      for(unsigned ply=0; ply<nPlies; ++ply)
+      {
+         const ChessMove& move = info.moves[ply];
+         m.hash = positionHash(position);
+         m.move = BinaryGameFormat::packMove(move);
+         occurrences.push_back(m);
+         g_chessRules.applyMove(position, move);
+      }
+   }
+   database.close();
+   //
+   std::sort(occurrences.begin(), occurrences.end());
+   //
+   std::vector<OpeningMoveStats> entries;
+   for(unsigned i=0; i<occurrences.size(); ++i)
+   {
+      const MoveOccurrence& o = occurrences[i];
+      if(entries.empty() || entries.back().hash!=o.hash || entries.back().move!=o.move)
+      {
+         OpeningMoveStats s;
+         memset(&s, 0, sizeof(s));
+         s.hash = o.hash;
+         s.move = o.move;
+         entries.push_back(s);
+      }
+      //
+      OpeningMoveStats& s = entries.back();
+      ++s.games;
+      switch(o.result)
+      {
+         case resultWhiteWins: ++s.whiteWins; break;
+         case resultDraw:      ++s.draws; break;
+         case resultBlackWins: ++s.blackWins; break;
+         default: break;
+      }
+   }
+   std::vector<MoveOccurrence>().swap(occurrences);
+   header.count = entries.size();
+   //
+   QFile file(explorerFileName(pgnFileName));
+   if(!file.open(QIODevice::WriteOnly|QIODevice::Truncate)) return false;
+   //
+   qint64 dataSize = (qint64)entries.size()*sizeof(OpeningMoveStats);
+   bool ok = file.write((const char *)&header, sizeof(header))==sizeof(header) &&
+             (entries.empty() || file.write((const char *)&entries[0], dataSize)==dataSize);
+   file.close();
+   //
+   if(!ok) file.remove();
+   return ok;
+}
+
+bool OpeningExplorer::open(const QString& pgnFileName)
+{
+   close();
+   //
+   ExplorerHeader expected;
+   if(!fillHeader(expected, pgnFileName)) return false;
+   //
+   file_.setFileName(explorerFileName(pgnFileName));
+   if(!file_.open(QIODevice::ReadOnly)) return false;
+   //
+   qint64 size = file_.size();
+   if(size<(qint64)sizeof(ExplorerHeader) ||
+      (data_ = file_.map(0, size))==0)
+   {
+      close();
+      return false;
+   }
+   //
+   ExplorerHeader header;
+   memcpy(&header, data_, sizeof(header));
+   expected.count = header.count;
+   //
+   if(memcmp(&header, &expected, sizeof(header))!=0 ||
+      size!=(qint64)sizeof(header)+(qint64)header.count*sizeof(OpeningMoveStats))
+   {
+      close();
+      return false;
+   }
+   //
+   pgnFileName_ = pgnFileName;
+   entries_ = (const OpeningMoveStats *)(data_ + sizeof(header));
+   count_ = header.count;
+   return true;
+}
+
+void OpeningExplorer::close()
+{
+   if(data_)
+   {
+      file_.unmap((uchar *)data_);
+      data_ = 0;
+   }
+   file_.close();
+   entries_ = 0;
+   count_ = 0;
+   pgnFileName_.clear();
+}
+
+bool OpeningExplorer::isOpen() const
+{
+   return data_!=0;
+}
+
+const QString& OpeningExplorer::pgnFileName() const
+{
+   return pgnFileName_;
+}
+
+void OpeningExplorer::lookup(const ChessPosition& position,
+                             std::vector<OpeningMoveStats>& moves) const
+{
+   moves.clear();
+   if(!entries_) return;
+   //
+   std::pair<const OpeningMoveStats *, const OpeningMoveStats *> range =
+         std::equal_range(entries_, entries_+count_, positionHash(position), HashLess());
+   //
+   moves.assign(range.first, range.second);
+   std::stable_sort(moves.begin(), moves.end(), morePopular);
+}
@@ -0,0 +1,61 @@
+#ifndef __OpeningExplorer_h
+#define __OpeningExplorer_h
+
+#include "ChessPosition.h"
+#include "ChessMove.h"
+
+#include <QFile>
+#include <QString>
+
+#include <vector>
+
+// statistics of a single move played from a position
+struct OpeningMoveStats
+{
+   quint64 hash;       // position before the move, see positionHash()
+   quint16 move;       // BinaryGameFormat::packMove()
+   quint16 reserved;
+   quint32 games;      // including games with unknown result
+   quint32 whiteWins;
+   quint32 draws;
+   quint32 blackWins;
+   quint32 reserved2;
+   //
+   ChessMove chessMove() const;
+};
+
+// OpeningExplorer shows which moves were played from a position in the
+// PGN database and how those games ended; the statistics are collected
+// once for the first moves of every game and written to a file next to
+// the PGN file, sorted by position hash, so a lookup is a binary search
+// over the memory-mapped file instead of a scan over the games
+// (native byte order, the file is rebuilt whenever the PGN file changes)
+
+class OpeningExplorer
+{
+public:
+   OpeningExplorer();
+   ~OpeningExplorer();
+
+   static bool build(const QString& pgnFileName); // creates or replaces the explorer file
+
+   bool open(const QString& pgnFileName); // fails if the explorer file is missing or outdated
+   void close();
+   bool isOpen() const;
+
+   const QString& pgnFileName() const;
+
+   // moves played from the given position, most popular first
+   void lookup(const ChessPosition& position, std::vector<OpeningMoveStats>& moves) const;
+
+   static QString explorerFileName(const QString& pgnFileName);
+
+private:
+   QString pgnFileName_;
+   QFile file_;
+   const uchar *data_;
+   const OpeningMoveStats *entries_;
+   unsigned count_;
+};
+
+#endif
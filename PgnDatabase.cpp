@@ -0,0 +1,393 @@
+#include "PgnDatabase.h"
+#include "PgnImporter.h"
+#include "StringUtils.h"
+
+#include <QFileInfo>
+#include <QDataStream>
+
+#include <string.h>
+
+namespace
+{
+
+const quint32 cIndexSignature = 0x4B335049; // "K3PI"
+const quint32 cIndexVersion = 2;
+
+const char *findLineEnd(const char *p, const char *end)
+{
+   const char *lineEnd = (const char *)memchr(p, '\n', end-p);
+   return lineEnd ? lineEnd : end;
+}
+
+const char *skipBlanks(const char *p, const char *end)
+{
+   while(p<end && (*p==' ' || *p=='\t' || *p=='\r')) ++p;
+   return p;
+}
+
+bool isResultToken(const std::string& token)
+{
+   return token=="1-0" || token=="0-1" || token=="1/2-1/2" || token=="*";
+}
+
+void addMoveToken(std::string token, std::vector<std::string>& tokens)
+{
+   // strip move number ("12." or "12...", possibly glued to the move)
+   size_t i = 0;
+   while(i<token.length() && token[i]>='0' && token[i]<='9') ++i;
+   if(i<token.length() && token[i]=='.')
+   {
+      while(i<token.length() && token[i]=='.') ++i;
+      token.erase(0, i);
+   }
+   //
+   if(token.empty() || isResultToken(token)) return;
+   //
+   // strip check marks and move annotations
+   while(!token.empty())
+   {
+      char c = token[token.length()-1];
+      if(c!='+' && c!='#' && c!='!' && c!='?') break;
+      token.erase(token.length()-1);
+   }
+   if(token.empty()) return;
+   //
+   // some programs write castling with zeros
+   if(token=="0-0") token = "O-O";
+   else if(token=="0-0-0") token = "O-O-O";
+   //
+   tokens.push_back(token);
+}
+
+QString tagValue(const std::string& value)
+{
+   return QString::fromUtf8(value.c_str(), value.length());
+}
+
+}
+
+PgnDatabase::PgnDatabase() : data_(0), size_(0), modified_(0)
+{
+}
+
+PgnDatabase::~PgnDatabase()
+{
+   close();
+}
+
+bool PgnDatabase::open(const QString& fileName)
+{
+   close();
+   //
+   file_.setFileName(fileName);
+   if(!file_.open(QIODevice::ReadOnly)) return false;
+   //
+   fileName_ = fileName;
+   size_ = file_.size();
+   modified_ = fileModificationTime(QFileInfo(file_));
+   //
+   if(size_>0)
+   {
+      data_ = (const char *)file_.map(0, size_);
+      if(!data_)
+      {
+         close();
+         return false;
+      }
+   }
+   //
+   if(!loadIndex())
+   {
+      buildIndex();
+      saveIndex(); // failure only means the index will be rebuilt next time
+   }
+   //
+   return true;
+}
+
+void PgnDatabase::close()
+{
+   if(data_)
+   {
+      file_.unmap((uchar *)data_);
+      data_ = 0;
+   }
+   file_.close();
+   games_.clear();
+   size_ = 0;
+   modified_ = 0;
+   fileName_.clear();
+}
+
+bool PgnDatabase::isOpen() const
+{
+   return file_.isOpen();
+}
+
+const QString& PgnDatabase::fileName() const
+{
+   return fileName_;
+}
+
+unsigned PgnDatabase::gameCount() const
+{
+   return games_.size();
+}
+
+const PgnGameEntry& PgnDatabase::entry(unsigned index) const
+{
+   assert(index<games_.size());
+   return games_[index];
+}
+
+QByteArray PgnDatabase::gameText(unsigned index) const
+{
+   if(index>=games_.size() || !data_) return QByteArray();
+   //
+   const PgnGameEntry& e = games_[index];
+   return QByteArray::fromRawData(data_ + e.offset, e.length);
+}
+
+QString PgnDatabase::indexFileName(const QString& pgnFileName)
+{
+   return pgnFileName + ".idx";
+}
+
+void PgnDatabase::buildIndex()
+{
+   games_.clear();
+   if(!data_) return;
+   //
+   const char *p = data_;
+   const char *end = data_ + size_;
+   //
+   PgnGameEntry game;
+   bool inGame = false;
+   bool inMoveText = false;
+   bool inComment = false;  // inside {...}, may span several lines
+   //
+   std::string name, value;
+   //
+   while(p<end)
+   {
+      const char *lineEnd = findLineEnd(p, end);
+      const char *s = skipBlanks(p, lineEnd);
+      //
+      if(s==lineEnd || *s=='%')
+      {
+         // empty or escaped line
+      }
+      else if(*s=='[' && !inComment)
+      {
+         if(!inGame || inMoveText)
+         {
+            // first tag of the next game
+            if(inGame)
+            {
+               game.length = (p-data_) - game.offset;
+               games_.push_back(game);
+            }
+            game = PgnGameEntry();
+            game.offset = p-data_;
+            inGame = true;
+            inMoveText = false;
+         }
+         //
+         if(parseTag(s, lineEnd, name, value))
+         {
+            if(name=="White") game.white = tagValue(value);
+            else if(name=="Black") game.black = tagValue(value);
+            else if(name=="Result") game.result = tagValue(value);
+            else if(name=="Date") game.date = tagValue(value);
+            else if(name=="Event") game.event = tagValue(value);
+         }
+      }
+      else
+      {
+         if(!inGame)
+         {
+            // a game without tags
+            game = PgnGameEntry();
+            game.offset = p-data_;
+            inGame = true;
+         }
+         inMoveText = true;
+         //
+         for(; s<lineEnd; ++s)
+         {
+            if(inComment)
+            {
+               if(*s=='}') inComment = false;
+            }
+            else if(*s=='{') inComment = true;
+            else if(*s==';') break; // comment up to the end of line
+         }
+      }
+      //
+      p = lineEnd<end ? lineEnd+1 : end;
+   }
+   //
+   if(inGame)
+   {
+      game.length = size_ - game.offset;
+      games_.push_back(game);
+   }
+}
+
+bool PgnDatabase::loadIndex()
+{
+   QFile file(indexFileName(fileName_));
+   if(!file.open(QIODevice::ReadOnly)) return false;
+   //
+   QDataStream in(&file);
+   in.setVersion(QDataStream::Qt_4_0);
+   //
+   quint32 signature = 0, version = 0, count = 0;
+   qint64 size = 0, modified = 0;
+   in >> signature >> version >> size >> modified >> count;
+   //
+   // the index is valid only for the very same PGN file
+   if(signature!=cIndexSignature || version!=cIndexVersion ||
+      size!=size_ || modified!=modified_) return false;
+   //
+   games_.clear();
+   games_.reserve(qMin(count, (quint32)(size_/16+1))); // don't trust a damaged count
+   for(quint32 i=0; i<count && in.status()==QDataStream::Ok; ++i)
+   {
+      PgnGameEntry e;
+      in >> e.offset >> e.length >> e.white >> e.black
+         >> e.result >> e.date >> e.event;
+      if(e.offset+e.length>(quint64)size_) break;
+      games_.push_back(e);
+   }
+   //
+   if(in.status()!=QDataStream::Ok || games_.size()!=count)
+   {
+      games_.clear();
+      return false;
+   }
+   return true;
+}
+
+bool PgnDatabase::saveIndex() const
+{
+   QFile file(indexFileName(fileName_));
+   if(!file.open(QIODevice::WriteOnly|QIODevice::Truncate)) return false;
+   //
+   QDataStream out(&file);
+   out.setVersion(QDataStream::Qt_4_0);
+   //
+   out << cIndexSignature << cIndexVersion << (qint64)size_
+       << (qint64)modified_ << (quint32)games_.size();
+   //
+   for(unsigned i=0; i<games_.size(); ++i)
+   {
+      const PgnGameEntry& e = games_[i];
+      out << e.offset << e.length << e.white << e.black
+          << e.result << e.date << e.event;
+   }
+   //
+   return out.status()==QDataStream::Ok;
+}
+
+bool PgnDatabase::readGame(unsigned index, GameSessionInfo& info) const
+{
+   QByteArray text = gameText(index);
+   if(text.isEmpty()) return false;
+   //
+   // a game with an illegal move is still opened up to that move
+   PgnImporter::parseGame(text.constData(), text.constData()+text.size(), info);
+   return !info.initialPosition.isEmpty();
+}
+
+bool PgnDatabase::parseTag(const char *begin, const char *end,
+                           std::string& name, std::string& value)
+{
+   name.clear();
+   value.clear();
+   //
+   const char *p = skipBlanks(begin, end);
+   if(p==end || *p!='[') return false;
+   ++p;
+   //
+   p = skipBlanks(p, end);
+   while(p<end && *p!=' ' && *p!='\t' && *p!='"' && *p!=']')
+   {
+      name.push_back(*p++);
+   }
+   //
+   p = skipBlanks(p, end);
+   if(p==end || *p!='"') return false;
+   ++p;
+   //
+   for(; p<end && *p!='"'; ++p)
+   {
+      if(*p=='\\' && p+1<end) ++p; // escaped quote or backslash
+      value.push_back(*p);
+   }
+   //
+   return p<end && !name.empty();
+}
+
+void PgnDatabase::extractMoveTokens(const char *begin, const char *end,
+                                    std::vector<std::string>& tokens)
+{
+   std::string token;
+   token.reserve(16);
+   //
+   int variationDepth = 0;
+   bool lineStart = true;
+   //
+   for(const char *p=begin; p<end; ++p)
+   {
+      char c = *p;
+      //
+      if(lineStart && c=='%')
+      {
+         // escaped line
+         const char *lineEnd = findLineEnd(p, end);
+         p = lineEnd<end ? lineEnd : end-1;
+         continue;
+      }
+      lineStart = c=='\n';
+      //
+      switch(c)
+      {
+         case '{':
+            {
+               const char *commentEnd = (const char *)memchr(p, '}', end-p);
+               p = commentEnd ? commentEnd : end-1;
+            }
+            break;
+         case ';':
+            {
+               const char *lineEnd = findLineEnd(p, end);
+               p = lineEnd<end ? lineEnd : end-1;
+               lineStart = true;
+            }
+            break;
+         case '(':
+            ++variationDepth;
+            break;
+         case ')':
+            if(variationDepth>0) --variationDepth;
+            break;
+         case '$':
+            while(p+1<end && p[1]>='0' && p[1]<='9') ++p; // numeric annotation glyph
+            break;
+         case ' ': case '\t': case '\r': case '\n':
+            break;
+         default:
+            token.push_back(c);
+            if(p+1<end)
+            {
+               char next = p[1];
+               if(next!=' ' && next!='\t' && next!='\r' && next!='\n' &&
+                  next!='{' && next!='(' && next!=')' && next!=';' && next!='$') continue;
+            }
+            if(variationDepth==0) addMoveToken(token, tokens);
+            token.clear();
+            break;
+      }
+   }
+}
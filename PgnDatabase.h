@@ -0,0 +1,72 @@
+#ifndef __PgnDatabase_h
+#define __PgnDatabase_h
+
+#include "GameSessionInfo.h"
+
+#include <QFile>
+#include <QString>
+#include <QByteArray>
+
+#include <vector>
+#include <string>
+
+// location and header fields of a single game in a PGN file
+struct PgnGameEntry
+{
+   quint64 offset;   // of the first tag line
+   quint32 length;   // up to the next game
+   QString white;
+   QString black;
+   QString result;
+   QString date;
+   QString event;
+   //
+   PgnGameEntry() : offset(0), length(0) {}
+};
+
+// PgnDatabase gives random access to games of a (possibly large) PGN file:
+// the file is memory-mapped and a game offset index is built in a single
+// pass and cached next to the PGN file, so opening a game does not require
+// parsing the games before it
+
+class PgnDatabase
+{
+public:
+   PgnDatabase();
+   ~PgnDatabase();
+
+   bool open(const QString& fileName); // maps the file, loads or (re)builds the index
+   void close();
+   bool isOpen() const;
+
+   const QString& fileName() const;
+
+   unsigned gameCount() const;
+   const PgnGameEntry& entry(unsigned index) const;
+
+   QByteArray gameText(unsigned index) const; // refers to the mapped file, valid until close()
+   bool readGame(unsigned index, GameSessionInfo& info) const; // replays game moves, stops at the first illegal one
+
+   static QString indexFileName(const QString& pgnFileName);
+
+   // PGN parsing helpers
+   static bool parseTag(const char *begin, const char *end,
+                        std::string& name, std::string& value);
+   static void extractMoveTokens(const char *begin, const char *end,
+                                 std::vector<std::string>& tokens); // SAN moves only (no comments, variations, NAGs, numbers and results)
+
+private:
+   void buildIndex();
+   bool loadIndex();
+   bool saveIndex() const;
+
+private:
+   QString fileName_;
+   QFile file_;
+   const char *data_;
+   qint64 size_;
+   qint64 modified_;
+   std::vector<PgnGameEntry> games_;
+};
+
+#endif
@@ -0,0 +1,285 @@
+#include "PgnImporter.h"
+#include "PgnDatabase.h"
+#include "ChessRules.h"
+
+#include <QThread>
+#include <QTime>
+
+#include <string.h>
+
+namespace
+{
+
+const unsigned cMaxThreads = 16;
+
+const char *findLineEnd(const char *p, const char *end)
+{
+   const char *lineEnd = (const char *)memchr(p, '\n', end-p);
+   return lineEnd ? lineEnd : end;
+}
+
+bool isPieceLetter(char c)
+{
+   return c=='K' || c=='Q' || c=='R' || c=='B' || c=='N';
+}
+
+// parses and validates a contiguous range of games of the database
+class ImportWorker : public QThread
+{
+public:
+   ImportWorker(const PgnDatabase& database, unsigned first, unsigned last) :
+      database_(database), first_(first), last_(last), nErrors_(0) {}
+
+   void run()
+   {
+      games_.reserve(last_-first_);
+      for(unsigned i=first_; i<last_; ++i)
+      {
+         QByteArray text = database_.gameText(i);
+         GameSessionInfo info;
+         //
+         if(!PgnImporter::parseGame(text.constData(), text.constData()+text.size(), info))
+         {
+            ++nErrors_;
+            if(info.initialPosition.isEmpty()) continue; // nothing to import
+         }
+         games_.push_back(info);
+      }
+   }
+
+   std::vector<GameSessionInfo>& games() { return games_; }
+   unsigned nErrors() const { return nErrors_; }
+
+private:
+   const PgnDatabase& database_;
+   unsigned first_;
+   unsigned last_;
+   unsigned nErrors_;
+   std::vector<GameSessionInfo> games_;
+};
+
+}
+
+PgnImporter::PgnImporter() : nThreads_(0)
+{
+}
+
+void PgnImporter::setThreadCount(unsigned n)
+{
+   nThreads_ = n;
+}
+
+bool PgnImporter::importFile(const QString& pgnFileName,
+                             std::vector<GameSessionInfo>& games,
+                             PgnImportStats& stats) const
+{
+   QTime timer;
+   timer.start();
+   //
+   stats = PgnImportStats();
+   games.clear();
+   //
+   PgnDatabase database;
+   if(!database.open(pgnFileName)) return false;
+   //
+   stats.nGames = database.gameCount();
+   //
+   unsigned nThreads = nThreads_ ? nThreads_ : (unsigned)qMax(QThread::idealThreadCount(), 1);
+   nThreads = qMin(qMin(nThreads, cMaxThreads), qMax(stats.nGames, 1u));
+   stats.nThreads = nThreads;
+   //
+   std::vector<ImportWorker *> workers;
+   workers.reserve(nThreads);
+   for(unsigned i=0; i<nThreads; ++i)
+   {
+      workers.push_back(new ImportWorker(database,
+                                         stats.nGames*i/nThreads,
+                                         stats.nGames*(i+1)/nThreads));
+   }
+   //
+   if(nThreads==1)
+   {
+      workers[0]->run(); // no need for an extra thread on single core devices
+   }
+   else
+   {
+      for(unsigned i=0; i<nThreads; ++i) workers[i]->start();
+      for(unsigned i=0; i<nThreads; ++i) workers[i]->wait();
+   }
+   //
+   // keep the original game order
+   games.reserve(stats.nGames);
+   for(unsigned i=0; i<nThreads; ++i)
+   {
+      std::vector<GameSessionInfo>& part = workers[i]->games();
+      games.insert(games.end(), part.begin(), part.end());
+      stats.nErrors += workers[i]->nErrors();
+      delete workers[i];
+   }
+   //
+   stats.nImported = games.size();
+   stats.elapsedTime = timer.elapsed();
+   return true;
+}
+
+bool PgnImporter::importFile(const QString& pgnFileName,
+                             const QString& collectionFileName,
+                             PgnImportStats& stats) const
+{
+   QTime timer;
+   timer.start();
+   //
+   std::vector<GameSessionInfo> games;
+   if(!importFile(pgnFileName, games, stats)) return false;
+   //
+   bool ok = GameSessionInfo::saveCollection(collectionFileName, games);
+   stats.elapsedTime = timer.elapsed();
+   return ok;
+}
+
+bool PgnImporter::parseGame(const char *begin, const char *end, GameSessionInfo& info)
+{
+   info = GameSessionInfo();
+   info.profile = GameProfile(gameTwoPlayers, ChessClock(), ChessClock());
+   //
+   std::string name, value, fen;
+   bool chess960 = false;
+   //
+   // tag section
+   const char *p = begin;
+   while(p<end)
+   {
+      const char *lineEnd = findLineEnd(p, end);
+      const char *s = p;
+      while(s<lineEnd && (*s==' ' || *s=='\t' || *s=='\r')) ++s;
+      if(s<lineEnd && *s!='[' && *s!='%') break;
+      //
+      if(s<lineEnd && *s=='[' && PgnDatabase::parseTag(s, lineEnd, name, value))
+      {
+         if(name=="FEN") fen = value;
+         else if(name=="Variant") chess960 = value.find("960")!=std::string::npos;
+      }
+      p = lineEnd<end ? lineEnd+1 : end;
+   }
+   //
+   if(fen.empty())
+   {
+      info.initialPosition = cStandardInitialPosition;
+   }
+   else
+   {
+      info.initialPosition = ChessPosition::fromString(fen);
+      if(info.initialPosition.isEmpty()) return false;
+      info.initialPosition.setChess960(chess960);
+   }
+   //
+   std::vector<std::string> tokens;
+   tokens.reserve(128);
+   PgnDatabase::extractMoveTokens(p, end, tokens);
+   //
+   // replay moves directly with ChessRules, there is no need
+   // for SAN strings, repetition tracking etc. done by ChessGame
+   ChessPosition position = info.initialPosition;
+   ChessMoveMap possibleMoves;
+   info.moves.reserve(tokens.size());
+   //
+   for(unsigned i=0; i<tokens.size(); ++i)
+   {
+      g_chessRules.findPossibleMoves(position, possibleMoves);
+      ChessMove move = resolveSANMove(position, possibleMoves, tokens[i]);
+      if(!move.assigned()) return false;
+      g_chessRules.applyMove(position, move);
+      info.moves.push_back(move);
+   }
+   //
+   return true;
+}
+
+ChessMove PgnImporter::resolveSANMove(const ChessPosition& position,
+                                      const ChessMoveMap& possibleMoves,
+                                      const std::string& san)
+{
+   if(san.length()<2) return ChessMove();
+   //
+   // castling: the king moves onto the rook in chess960,
+   // two squares aside in standard chess
+   if(san=="O-O" || san=="O-O-O")
+   {
+      bool isShort = san.length()==3;
+      ChessCoord from = position.initialKingCoord();
+      ChessCoord to(0, from.row);
+      if(position.isChess960())
+         to.col = isShort ? position.initialRightRookCoord().col :
+                            position.initialLeftRookCoord().col;
+      else
+         to.col = isShort ? position.maxCol()-1 : 3;
+      //
+      CoordPair cpair(from, to);
+      return possibleMoves.contains(cpair) ? ChessMove(cpair) : ChessMove();
+   }
+   //
+   // remaining forms: [piece][from col][from row][x]<to col><to row>[=promotion]
+   PieceType pt = ptPawn;
+   unsigned i = 0;
+   if(isPieceLetter(san[0]))
+   {
+      pt = ChessPiece::fromChar(san[0]).type();
+      ++i;
+   }
+   //
+   PieceType promotion = ptNone;
+   std::string squares;
+   squares.reserve(4);
+   for(; i<san.length(); ++i)
+   {
+      char c = san[i];
+      if(colFromChar(c) || rowFromChar(c))
+         squares.push_back(c);
+      else if(isPieceLetter(c) && pt==ptPawn)
+         promotion = ChessPiece::fromChar(c).type();
+      else if(c!='x' && c!='-' && c!='=' && c!=':')
+         return ChessMove();
+   }
+   //
+   if(squares.length()<2 || promotion==ptKing) return ChessMove();
+   ChessCoord to(colFromChar(squares[squares.length()-2]),
+                 rowFromChar(squares[squares.length()-1]));
+   if(!position.inRange(to)) return ChessMove();
+   //
+   ColValue fromCol = 0;
+   RowValue fromRow = 0;
+   for(unsigned j=0; j+2<squares.length(); ++j)
+   {
+      if(colFromChar(squares[j])) fromCol = colFromChar(squares[j]);
+      else fromRow = rowFromChar(squares[j]);
+   }
+   //
+   ChessMove found;
+   unsigned nFound = 0;
+   ChessMoveMap::const_iterator_pair range = possibleMoves.getAllMoves();
+   for(; range.first!=range.second; ++range.first)
+   {
+      const CoordPair& cpair = *range.first;
+      if(cpair.to!=to) continue;
+      if(fromCol && cpair.from.col!=fromCol) continue;
+      if(fromRow && cpair.from.row!=fromRow) continue;
+      //
+      ChessPiece piece = position.cell(cpair.from);
+      if(piece.type()!=pt) continue;
+      //
+      // a king "capturing" its own rook is castling, not a king move
+      if(pt==ptKing && position.cell(to).type()==ptRook &&
+         position.cell(to).color()==piece.color()) continue;
+      //
+      found = ChessMove(cpair);
+      ++nFound;
+   }
+   //
+   if(nFound!=1) return ChessMove(); // illegal or ambiguous
+   //
+   if(pt==ptPawn && g_chessRules.isPromotionMove(position, found))
+   {
+      found.promotion = promotion==ptNone ? ptQueen : promotion;
+   }
+   return found;
+}
@@ -0,0 +1,58 @@
+#ifndef __PgnImporter_h
+#define __PgnImporter_h
+
+#include "GameSessionInfo.h"
+#include "ChessMoveMap.h"
+
+#include <QString>
+
+#include <vector>
+#include <string>
+
+struct PgnImportStats
+{
+   unsigned nGames;     // games found in the PGN file
+   unsigned nImported;  // games stored in the collection
+   unsigned nErrors;    // games with an illegal or unreadable move (imported up to that move)
+   unsigned nThreads;
+   int elapsedTime;     // ms
+   //
+   PgnImportStats() : nGames(0), nImported(0), nErrors(0), nThreads(0), elapsedTime(0) {}
+   //
+   unsigned gamesPerSecond() const
+   {
+      return elapsedTime>0 ? (unsigned)(nGames*1000.0/elapsedTime) : nGames;
+   }
+};
+
+// PgnImporter converts PGN files into binary game collections:
+// the file is split into games by PgnDatabase, then the games are
+// parsed and their SAN moves validated with ChessRules in parallel
+// worker threads
+
+class PgnImporter
+{
+public:
+   PgnImporter();
+
+   void setThreadCount(unsigned n); // 0 means one thread per CPU core
+
+   bool importFile(const QString& pgnFileName, std::vector<GameSessionInfo>& games,
+                   PgnImportStats& stats) const;
+   bool importFile(const QString& pgnFileName, const QString& collectionFileName,
+                   PgnImportStats& stats) const;
+
+   // parses a single game (tags and movetext); returns false if the game is
+   // unreadable or contains an illegal move (moves before it are kept in info)
+   static bool parseGame(const char *begin, const char *end, GameSessionInfo& info);
+
+   // finds SAN move among the possible moves of the given position
+   static ChessMove resolveSANMove(const ChessPosition& position,
+                                   const ChessMoveMap& possibleMoves,
+                                   const std::string& san);
+
+private:
+   unsigned nThreads_;
+};
+
+#endif
@@ -18,14 +18,15 @@ void PieceCoordMap::loadPiecePositions(const ChessPosition& position)
    piecesOnRow_.resize(position.maxRow()+1);  // item[0] is not used
    piecesOnCol_.resize(position.maxCol()+1);  // item[0] is not used
    //
+   // only pieces of the side to move are listed, take them from the position piece lists
+   PieceColor color = position.sideToMove();
    PieceCoord pc;
-   for(pc.col=1;pc.col<=position.maxCol();++pc.col)
+   for(PieceType type=ptFirst;type<=ptLast;++type)
    {
-      for(pc.row=1;pc.row<=position.maxRow();++pc.row)
+      for(unsigned i=0;i<position.pieceCount(color, type);++i)
       {
-         ChessPiece piece = position.cell(coord);
-         if(piece.type()==ptNone || piece.color()!=position.sideToMove()) continue;
-         pc.value = piece.value;
+         static_cast<ChessCoord&>(pc) = position.pieceCoord(color, type, i);
+         pc.value = position.cell(pc).value;
          piecesOnRow_[pc.row].push_back(pc);
          piecesOnCol_[pc.col].push_back(pc);
       }
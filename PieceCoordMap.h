@@ -24,6 +24,9 @@ public:
     PieceCoord getNextPieceByType(PieceType pt);
     ChessCoord getNextTargetCellByCol(int col);
 
+private:
+    void loadPiecePositions(const ChessPosition& position);
+
 private:
     typedef std::list<PieceCoord> PieceCoordList;
     std::vector<PieceCoordList> piecesOnRow_;
@@ -0,0 +1,240 @@
+#include "PieceSpriteCache.h"
+#include "Settings.h"
+#include "StringUtils.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDataStream>
+#include <QVector>
+
+namespace
+{
+
+const unsigned cMaxAtlases = 4; // board and captured pieces in two orientations
+const int cMaxDiskAtlases = 4;  // per style, older sizes and modes are removed
+const int cAtlasCols = 7;       // _KQRBNP
+const int cAtlasRows = 4;       // w/w, b/w, w/b, b/b (piece/square)
+const quint32 cCacheSignature = 0x4B335350; // "K3SP"
+const quint32 cCacheVersion = 4;
+const QImage::Format cAtlasFormat = QImage::Format_ARGB32_Premultiplied; // fastest to draw
+
+// 4x4 Bayer matrix for ordered dithering
+const int cBayer[4][4] = { {  0,  8,  2, 10 },
+                           { 12,  4, 14,  6 },
+                           {  3, 11,  1,  9 },
+                           { 15,  7, 13,  5 } };
+
+QVector<QRgb> grayColorTable(unsigned levels)
+{
+   QVector<QRgb> table(levels);
+   for(unsigned i=0; i<levels; ++i)
+   {
+      int v = i*255/(levels-1);
+      table[i] = qRgb(v, v, v);
+   }
+   return table;
+}
+
+// reduces the image to the given number of gray levels (2..256),
+// transparent parts are blended with white (the e-ink "paper");
+// the result keeps the atlas format, indexed images are slow to draw
+QImage toGrayLevels(const QImage& source, unsigned levels, bool dither)
+{
+   QImage argb = source.convertToFormat(QImage::Format_ARGB32);
+   QImage result(argb.width(), argb.height(), cAtlasFormat);
+   QVector<QRgb> grays = grayColorTable(levels); // opaque, so premultiplied as well
+   //
+   for(int y=0; y<argb.height(); ++y)
+   {
+      const QRgb *src = (const QRgb *)argb.constScanLine(y);
+      QRgb *dst = (QRgb *)result.scanLine(y);
+      for(int x=0; x<argb.width(); ++x)
+      {
+         int a = qAlpha(src[x]);
+         int gray = (qGray(src[x])*a + 255*(255-a))/255;
+         //
+         // level in 1/16 steps, rounded either with a fixed 1/2 step or with
+         // the Bayer threshold of the pixel (0..15/16 step, 1/2 on average)
+         int level16 = gray*(levels-1)*16/255;
+         level16 += dither ? cBayer[y&3][x&3] : 8;
+         //
+         int level = level16/16;
+         dst[x] = grays[level>=(int)levels ? levels-1 : level];
+      }
+   }
+   return result;
+}
+
+}
+
+PieceSpriteCache::PieceSpriteCache() :
+   grayLevels_(g_settings.spriteGrayLevels()),
+   dither_(g_settings.ditherSprites())
+{
+   if(grayLevels_==1) grayLevels_ = 2;
+   if(grayLevels_>256) grayLevels_ = 256;
+}
+
+PieceSpriteCache::~PieceSpriteCache()
+{
+}
+
+QImage PieceSpriteCache::atlas(const QString& imageFile, int squareSize)
+{
+   if(imageFile.isEmpty() || squareSize<=0) return QImage();
+   //
+   for(AtlasList::iterator it=atlases_.begin(); it!=atlases_.end(); ++it)
+   {
+      if(it->squareSize==squareSize && it->imageFile==imageFile)
+      {
+         atlases_.splice(atlases_.begin(), atlases_, it);
+         return atlases_.front().image;
+      }
+   }
+   //
+   Atlas atlas;
+   atlas.imageFile = imageFile;
+   atlas.squareSize = squareSize;
+   //
+   if(!readDiskCache(imageFile, squareSize, atlas.image))
+   {
+      atlas.image = scaleOriginal(imageFile, squareSize);
+      if(atlas.image.isNull()) return QImage();
+      writeDiskCache(imageFile, squareSize, atlas.image);
+   }
+   //
+   atlases_.push_front(atlas);
+   if(atlases_.size()>cMaxAtlases) atlases_.pop_back();
+   //
+   return atlas.image;
+}
+
+void PieceSpriteCache::clear()
+{
+   atlases_.clear();
+   originals_.clear();
+}
+
+QRect PieceSpriteCache::spriteRect(int squareSize, ChessPiece piece, bool blackSquare)
+{
+   int row = (blackSquare ? 2 : 0) + (piece.type()!=ptNone && piece.color()==pcBlack ? 1 : 0);
+   return QRect(piece.type()*squareSize, row*squareSize, squareSize, squareSize);
+}
+
+QImage PieceSpriteCache::scaleOriginal(const QString& imageFile, int squareSize)
+{
+   std::map<QString, QImage>::iterator it = originals_.find(imageFile);
+   if(it==originals_.end())
+   {
+      it = originals_.insert(std::make_pair(imageFile, QImage(imageFile))).first;
+   }
+   if(it->second.isNull()) return QImage();
+   //
+   QImage scaled = it->second.scaled(squareSize*cAtlasCols, squareSize*cAtlasRows,
+                                     Qt::KeepAspectRatio, Qt::SmoothTransformation);
+   //
+   // converted once here, so that drawing sprites needs no conversion
+   if(grayLevels_>0) return toGrayLevels(scaled, grayLevels_, dither_);
+   return scaled.convertToFormat(cAtlasFormat);
+}
+
+QString PieceSpriteCache::diskCacheFile(const QString& imageFile, int squareSize) const
+{
+   QString dir = g_settings.spriteCacheDir();
+   if(dir.isEmpty()) return QString();
+   //
+   QString mode = grayLevels_>0 ? QString("g%1%2").arg(grayLevels_).arg(dither_ ? "d" : "") : QString("c");
+   QString name = QString("%1-%2-%3-%4.sprites").
+         arg(QFileInfo(imageFile).completeBaseName()).
+         arg(qHash(QFileInfo(imageFile).absoluteFilePath()), 8, 16, QChar('0')).
+         arg(squareSize).
+         arg(mode);
+   return QDir(dir).filePath(name);
+}
+
+bool PieceSpriteCache::readDiskCache(const QString& imageFile, int squareSize, QImage& image) const
+{
+   QString cacheFile = diskCacheFile(imageFile, squareSize);
+   if(cacheFile.isEmpty()) return false;
+   //
+   QFile file(cacheFile);
+   if(!file.open(QIODevice::ReadOnly)) return false;
+   //
+   QFileInfo source(imageFile);
+   //
+   QDataStream in(&file);
+   in.setVersion(QDataStream::Qt_4_0);
+   //
+   quint32 signature = 0, version = 0, format = 0, nColors = 0;
+   qint64 sourceSize = 0, modified = 0;
+   qint32 width = 0, height = 0;
+   in >> signature >> version >> sourceSize >> modified >> width >> height >> format >> nColors;
+   //
+   // the cache is valid only for the very same image file and atlas format
+   if(in.status()!=QDataStream::Ok || signature!=cCacheSignature || version!=cCacheVersion ||
+      sourceSize!=source.size() || modified!=fileModificationTime(source) ||
+      format!=(quint32)cAtlasFormat || nColors!=grayLevels_ ||
+      width<=0 || height<=0 || width>squareSize*cAtlasCols || height>squareSize*cAtlasRows) return false;
+   //
+   QImage result(width, height, cAtlasFormat);
+   int lineSize = width*4;
+   for(int y=0; y<height; ++y)
+   {
+      if(in.readRawData((char *)result.scanLine(y), lineSize)!=lineSize) return false;
+   }
+   //
+   image = result;
+   return true;
+}
+
+void PieceSpriteCache::writeDiskCache(const QString& imageFile, int squareSize, const QImage& image) const
+{
+   QString cacheFile = diskCacheFile(imageFile, squareSize);
+   if(cacheFile.isEmpty()) return;
+   //
+   QDir().mkpath(QFileInfo(cacheFile).absolutePath());
+   //
+   QFile file(cacheFile);
+   if(!file.open(QIODevice::WriteOnly|QIODevice::Truncate)) return; // no cache, only slower start
+   //
+   QFileInfo source(imageFile);
+   //
+   QDataStream out(&file);
+   out.setVersion(QDataStream::Qt_4_0);
+   //
+   // raw pixels: loading them is a plain copy, unlike decoding PNG
+   out << cCacheSignature << cCacheVersion << (qint64)source.size()
+       << fileModificationTime(source)
+       << (qint32)image.width() << (qint32)image.height() << (quint32)image.format()
+       << (quint32)grayLevels_;
+   //
+   int lineSize = image.width()*4;
+   for(int y=0; y<image.height(); ++y)
+   {
+      out.writeRawData((const char *)image.constScanLine(y), lineSize);
+   }
+   //
+   if(out.status()!=QDataStream::Ok)
+   {
+      file.close();
+      file.remove();
+      return;
+   }
+   //
+   removeOldDiskCache(cacheFile);
+}
+
+void PieceSpriteCache::removeOldDiskCache(const QString& cacheFile) const
+{
+   // files of the same style differ only in the size and the mode parts of the name
+   QFileInfo fi(cacheFile);
+   QString pattern = fi.fileName().section('-', 0, -3) + "-*.sprites";
+   //
+   QDir dir = fi.absoluteDir();
+   QFileInfoList files = dir.entryInfoList(QStringList(pattern), QDir::Files, QDir::Time);
+   for(int i=cMaxDiskAtlases; i<files.size(); ++i)
+   {
+      if(files[i].fileName()!=fi.fileName()) dir.remove(files[i].fileName());
+   }
+}
@@ -0,0 +1,62 @@
+#ifndef __PieceSpriteCache_h
+#define __PieceSpriteCache_h
+
+#include "Singletons.h"
+#include "ChessPiece.h"
+
+#include <QString>
+#include <QImage>
+#include <QRect>
+
+#include <list>
+#include <map>
+
+// PieceSpriteCache gives all views the pieces image ("atlas" of 7 x 4
+// squares, see ChessBoardView.cpp) of a style smoothly scaled to the
+// required square size; scaled atlases are shared between views, kept
+// in memory for a few recently used sizes and stored on disk (a few most
+// recently written sizes per style), so the program start and a screen
+// rotation normally load a ready atlas instead of scaling the original
+// image again;
+// for grayscale e-ink screens atlases can be reduced to a few gray levels,
+// optionally with ordered dithering (see K3ChessSettings::spriteGrayLevels());
+// gray atlases are still stored as ARGB pixels, which draw fastest
+
+class PieceSpriteCache
+{
+   friend void Singletons::initialize();
+   friend void Singletons::finalize();
+
+   PieceSpriteCache();
+   ~PieceSpriteCache();
+
+public:
+   QImage atlas(const QString& imageFile, int squareSize); // null image if the style cannot be loaded
+   void clear(); // memory cache only
+
+   // area of the piece (or of the empty square if piece type is ptNone) in an atlas
+   static QRect spriteRect(int squareSize, ChessPiece piece, bool blackSquare);
+
+private:
+   struct Atlas
+   {
+      QString imageFile;
+      int squareSize;
+      QImage image;
+   };
+   typedef std::list<Atlas> AtlasList;
+   //
+   QImage scaleOriginal(const QString& imageFile, int squareSize);
+   QString diskCacheFile(const QString& imageFile, int squareSize) const;
+   bool readDiskCache(const QString& imageFile, int squareSize, QImage& image) const;
+   void writeDiskCache(const QString& imageFile, int squareSize, const QImage& image) const;
+   void removeOldDiskCache(const QString& cacheFile) const; // keeps the most recently written files of the style
+
+private:
+   AtlasList atlases_; // most recently used first
+   std::map<QString, QImage> originals_; // loaded only when an atlas has to be scaled
+   unsigned grayLevels_; // 0 - full color
+   bool dither_;
+};
+
+#endif
@@ -0,0 +1,336 @@
+#include "PolyglotBook.h"
+#include "ChessRules.h"
+#include "Random.h"
+#include "MoveCache.h"
+
+#include <QTextStream>
+#include <QStringList>
+#include <QRegExp>
+
+namespace
+{
+
+const unsigned cKeyCount = 781;
+const unsigned cCastleKeys = 768;
+const unsigned cEnPassantKeys = 772;
+const unsigned cTurnKey = 780;
+
+const quint64 cInitialPositionKey = Q_UINT64_C(0x463b96181691fc9c);
+
+std::vector<quint64>& keyTable()
+{
+   static std::vector<quint64> keys;
+   return keys;
+}
+
+quint64 readBigEndian(const uchar *p, int nBytes)
+{
+   quint64 value = 0;
+   for(int i=0; i<nBytes; ++i) value = (value<<8) | p[i];
+   return value;
+}
+
+void writeBigEndian(uchar *p, quint64 value, int nBytes)
+{
+   for(int i=nBytes-1; i>=0; --i)
+   {
+      p[i] = (uchar)(value & 0xFF);
+      value >>= 8;
+   }
+}
+
+// Polyglot piece order: black pawn, white pawn, black knight, ... white king
+unsigned pieceKind(ChessPiece piece)
+{
+   unsigned kind = 0;
+   switch(piece.type())
+   {
+      case ptPawn:   kind = 0; break;
+      case ptKnight: kind = 1; break;
+      case ptBishop: kind = 2; break;
+      case ptRook:   kind = 3; break;
+      case ptQueen:  kind = 4; break;
+      case ptKing:   kind = 5; break;
+   }
+   return kind*2 + (piece.color()==pcWhite ? 1 : 0);
+}
+
+bool isOwnRook(const ChessPosition& position, ChessCoord coord, PieceColor color)
+{
+   ChessPiece piece = position.cell(coord);
+   return piece.type()==ptRook && piece.color()==color;
+}
+
+}
+
+PolyglotBook::PolyglotBook() : data_(0), count_(0)
+{
+}
+
+PolyglotBook::~PolyglotBook()
+{
+   close();
+}
+
+bool PolyglotBook::loadKeys(const QString& fileName)
+{
+   QFile file(fileName);
+   if(!file.open(QIODevice::ReadOnly|QIODevice::Text)) return false;
+   //
+   // parentheses separate tokens too, so U64(0x...) gives "U64" and "0x..."
+   QStringList tokens = QTextStream(&file).readAll().split(QRegExp("[\\s,;{}=()]+"),
+                                                           QString::SkipEmptyParts);
+   // a hex literal with at most one integer suffix (0x..., 0x...ULL)
+   QRegExp hexLiteral("0x([0-9a-f]{1,16})(ull|ul|u|l)?", Qt::CaseInsensitive);
+   std::vector<quint64> keys;
+   keys.reserve(cKeyCount);
+   for(int i=0; i<tokens.size(); ++i)
+   {
+      // declarations and macro names are skipped
+      if(!tokens[i].startsWith("0x", Qt::CaseInsensitive)) continue;
+      if(!hexLiteral.exactMatch(tokens[i])) return false;
+      keys.push_back(hexLiteral.cap(1).toULongLong(0, 16));
+   }
+   //
+   if(keys.size()!=cKeyCount) return false;
+   //
+   // a wrong table would silently find nothing in any book, so the keys are
+   // checked against the initial position key of the book format description
+   keyTable().swap(keys);
+   if(positionKey(cStandardInitialPosition)!=cInitialPositionKey)
+   {
+      keyTable().clear();
+      return false;
+   }
+   return true;
+}
+
+bool PolyglotBook::keysLoaded()
+{
+   return keyTable().size()==cKeyCount;
+}
+
+quint64 PolyglotBook::positionKey(const ChessPosition& position)
+{
+   assert(keysLoaded());
+   const std::vector<quint64>& keys = keyTable();
+   quint64 key = 0;
+   //
+   ChessCoord coord;
+   for(coord.row=1; coord.row<=position.maxRow(); ++coord.row)
+   {
+      for(coord.col=1; coord.col<=position.maxCol(); ++coord.col)
+      {
+         ChessPiece piece = position.cell(coord);
+         if(piece.type()==ptNone) continue;
+         key ^= keys[64*pieceKind(piece) + 8*(coord.row-1) + (coord.col-1)];
+      }
+   }
+   //
+   // castling flags are in the same order as in Polyglot (KQkq)
+   unsigned castling = position.castlingFlags();
+   for(unsigned i=0; i<4; ++i)
+   {
+      if(castling & (1<<i)) key ^= keys[cCastleKeys+i];
+   }
+   //
+   // en passant file counts only if a pawn of the side to move can capture
+   ChessCoord pawnJump = position.pawnJump();
+   if(pawnJump!=ChessCoord())
+   {
+      ChessPiece pawn(ptPawn | position.sideToMove());
+      ChessCoord left(pawnJump.col-1, pawnJump.row);
+      ChessCoord right(pawnJump.col+1, pawnJump.row);
+      if((position.inRange(left) && position.cell(left)==pawn) ||
+         (position.inRange(right) && position.cell(right)==pawn))
+      {
+         key ^= keys[cEnPassantKeys + pawnJump.col-1];
+      }
+   }
+   //
+   if(position.sideToMove()==pcWhite) key ^= keys[cTurnKey];
+   //
+   return key;
+}
+
+quint16 PolyglotBook::encodeMove(const ChessPosition& position, const ChessMove& move)
+{
+   ChessCoord to = move.to;
+   ChessPiece piece = position.cell(move.from);
+   //
+   // standard chess castling e1g1/e1c1 becomes e1h1/e1a1
+   if(piece.type()==ptKing && !position.isChess960() &&
+      move.from.col==5 && (to.col==7 || to.col==3) && to.row==move.from.row)
+   {
+      to.col = to.col==7 ? 8 : 1;
+   }
+   //
+   quint16 promotion = 0;
+   switch(move.promotion)
+   {
+      case ptKnight: promotion = 1; break;
+      case ptBishop: promotion = 2; break;
+      case ptRook:   promotion = 3; break;
+      case ptQueen:  promotion = 4; break;
+   }
+   //
+   return (to.col-1) | ((to.row-1)<<3) |
+         ((move.from.col-1)<<6) | ((move.from.row-1)<<9) | (promotion<<12);
+}
+
+ChessMove PolyglotBook::decodeMove(const ChessPosition& position, quint16 move)
+{
+   ChessMove m;
+   m.to = ChessCoord((move & 7) + 1, ((move>>3) & 7) + 1);
+   m.from = ChessCoord(((move>>6) & 7) + 1, ((move>>9) & 7) + 1);
+   //
+   switch((move>>12) & 7)
+   {
+      case 1: m.promotion = ptKnight; break;
+      case 2: m.promotion = ptBishop; break;
+      case 3: m.promotion = ptRook; break;
+      case 4: m.promotion = ptQueen; break;
+   }
+   //
+   // "king takes own rook" is castling, ChessRules expects the king
+   // to move two squares aside in standard chess
+   ChessPiece piece = position.cell(m.from);
+   if(piece.type()==ptKing && !position.isChess960() &&
+      isOwnRook(position, m.to, piece.color()))
+   {
+      m.to.col = m.to.col>m.from.col ? 7 : 3;
+   }
+   return m;
+}
+
+void PolyglotBook::writeEntry(uchar *p, const PolyglotBookEntry& entry)
+{
+   writeBigEndian(p, entry.key, 8);
+   writeBigEndian(p+8, entry.move, 2);
+   writeBigEndian(p+10, entry.weight, 2);
+   writeBigEndian(p+12, entry.learn, 4);
+}
+
+bool PolyglotBook::open(const QString& fileName)
+{
+   close();
+   if(!keysLoaded()) return false;
+   //
+   file_.setFileName(fileName);
+   if(!file_.open(QIODevice::ReadOnly)) return false;
+   //
+   qint64 size = file_.size();
+   if(size==0 || size%cEntrySize!=0 || (data_ = file_.map(0, size))==0)
+   {
+      close();
+      return false;
+   }
+   //
+   fileName_ = fileName;
+   count_ = size/cEntrySize;
+   return true;
+}
+
+void PolyglotBook::close()
+{
+   if(data_)
+   {
+      file_.unmap((uchar *)data_);
+      data_ = 0;
+   }
+   file_.close();
+   count_ = 0;
+   fileName_.clear();
+}
+
+bool PolyglotBook::isOpen() const
+{
+   return data_!=0;
+}
+
+const QString& PolyglotBook::fileName() const
+{
+   return fileName_;
+}
+
+PolyglotBookEntry PolyglotBook::entryAt(unsigned index) const
+{
+   const uchar *p = data_ + index*cEntrySize;
+   PolyglotBookEntry entry;
+   entry.key = readBigEndian(p, 8);
+   entry.move = readBigEndian(p+8, 2);
+   entry.weight = readBigEndian(p+10, 2);
+   entry.learn = readBigEndian(p+12, 4);
+   return entry;
+}
+
+unsigned PolyglotBook::lowerBound(quint64 key) const
+{
+   unsigned lo = 0, hi = count_;
+   while(lo<hi)
+   {
+      unsigned mid = lo + (hi-lo)/2;
+      if(readBigEndian(data_ + mid*cEntrySize, 8)<key)
+         lo = mid+1;
+      else
+         hi = mid;
+   }
+   return lo;
+}
+
+void PolyglotBook::findMoves(const ChessPosition& position, std::vector<ChessMove>& moves,
+                             std::vector<unsigned>& weights) const
+{
+   moves.clear();
+   weights.clear();
+   if(!data_) return;
+   //
+   quint64 key = positionKey(position);
+   unsigned i = lowerBound(key);
+   if(i>=count_ || readBigEndian(data_ + i*cEntrySize, 8)!=key) return;
+   //
+   // a damaged book or a key collision must not produce an illegal move
+   ChessMoveMap possibleMoves;
+   g_moveCache.findPossibleMoves(position, possibleMoves);
+   //
+   for(; i<count_; ++i)
+   {
+      PolyglotBookEntry entry = entryAt(i);
+      if(entry.key!=key) break;
+      //
+      ChessMove move = decodeMove(position, entry.move);
+      if(!possibleMoves.contains(move)) continue;
+      if(move.promotion==ptNone && g_chessRules.isPromotionMove(position, move)) continue;
+      //
+      // entries of a position are sorted by weight in well-formed books,
+      // but this is not guaranteed
+      unsigned j = weights.size();
+      while(j>0 && weights[j-1]<entry.weight) --j;
+      moves.insert(moves.begin()+j, move);
+      weights.insert(weights.begin()+j, entry.weight);
+   }
+}
+
+bool PolyglotBook::pickMove(const ChessPosition& position, ChessMove& move) const
+{
+   std::vector<ChessMove> moves;
+   std::vector<unsigned> weights;
+   findMoves(position, moves, weights);
+   //
+   unsigned total = 0;
+   for(unsigned i=0; i<weights.size(); ++i) total += weights[i];
+   if(total==0) return false; // also if all moves have zero weight (not to be played)
+   //
+   unsigned r = g_random.get(0, total-1);
+   for(unsigned i=0; i<moves.size(); ++i)
+   {
+      if(r<weights[i])
+      {
+         move = moves[i];
+         return true;
+      }
+      r -= weights[i];
+   }
+   move = moves[0];
+   return true;
+}
@@ -0,0 +1,73 @@
+#ifndef __PolyglotBook_h
+#define __PolyglotBook_h
+
+#include "ChessPosition.h"
+#include "ChessMove.h"
+
+#include <QFile>
+#include <QString>
+
+#include <vector>
+
+// single book entry (decoded, the file stores them big-endian)
+struct PolyglotBookEntry
+{
+   quint64 key;
+   quint16 move;   // Polyglot move encoding
+   quint16 weight;
+   quint32 learn;
+};
+
+// PolyglotBook reads opening books in Polyglot .bin format:
+// the book is memory-mapped and entries (sorted by position key)
+// are found with binary search
+//
+// position keys are Polyglot Zobrist keys: the 781 "Random64" values
+// of the Polyglot book format are read from a text file (hex numbers,
+// e.g. the C array from the format description pasted as is, with or
+// without the U64() macro) with loadKeys(); the table is rejected if
+// the initial position key differs from the one in the format
+// description; books cannot be opened until the keys are loaded
+
+class PolyglotBook
+{
+public:
+   PolyglotBook();
+   ~PolyglotBook();
+
+   bool open(const QString& fileName);
+   void close();
+   bool isOpen() const;
+
+   const QString& fileName() const;
+
+   // legal book moves for the position, best (highest weight) first
+   void findMoves(const ChessPosition& position, std::vector<ChessMove>& moves,
+                  std::vector<unsigned>& weights) const;
+   // picks a book move at random, proportionally to move weights
+   bool pickMove(const ChessPosition& position, ChessMove& move) const;
+
+   static bool loadKeys(const QString& fileName);
+   static bool keysLoaded();
+   static quint64 positionKey(const ChessPosition& position);
+
+   // conversion between ChessMove and Polyglot move encoding
+   // (Polyglot castling is always written as "king takes own rook")
+   static quint16 encodeMove(const ChessPosition& position, const ChessMove& move);
+   static ChessMove decodeMove(const ChessPosition& position, quint16 move);
+
+   static const unsigned cEntrySize = 16;
+   static void writeEntry(uchar *p, const PolyglotBookEntry& entry);
+
+private:
+   PolyglotBookEntry entryAt(unsigned index) const;
+   unsigned lowerBound(quint64 key) const;
+
+private:
+   QString fileName_;
+   QFile file_;
+   const uchar *data_;
+   unsigned count_;
+};
+
+#endif
@@ -0,0 +1,84 @@
+#include "PositionHash.h"
+
+namespace
+{
+
+const int cBoardCells = 64;
+const int cPieceKinds = 12; // 6 types x 2 colors
+const quint64 cSeed = Q_UINT64_C(0x4B33436865737331); // "K3Chess1"
+
+class ZobristKeys
+{
+public:
+   ZobristKeys()
+   {
+      quint64 state = cSeed;
+      for(int i=0; i<cPieceKinds; ++i)
+      {
+         for(int j=0; j<cBoardCells; ++j) pieces[i][j] = next(state);
+      }
+      for(int i=0; i<4; ++i) castling[i] = next(state);
+      for(int i=0; i<8; ++i) enPassant[i] = next(state);
+      blackToMove = next(state);
+   }
+   //
+   quint64 pieces[cPieceKinds][cBoardCells];
+   quint64 castling[4]; // in ChessPosition::castlingFlags() bit order
+   quint64 enPassant[8];
+   quint64 blackToMove;
+
+private:
+   // splitmix64, simple and with good enough distribution for hashing
+   static quint64 next(quint64& state)
+   {
+      quint64 z = (state += Q_UINT64_C(0x9E3779B97F4A7C15));
+      z = (z ^ (z>>30)) * Q_UINT64_C(0xBF58476D1CE4E5B9);
+      z = (z ^ (z>>27)) * Q_UINT64_C(0x94D049BB133111EB);
+      return z ^ (z>>31);
+   }
+};
+
+const ZobristKeys& keys()
+{
+   static const ZobristKeys zobristKeys;
+   return zobristKeys;
+}
+
+}
+
+quint64 positionHash(const ChessPosition& position)
+{
+   if(position.isEmpty()) return 0;
+   //
+   const ZobristKeys& k = keys();
+   quint64 hash = 0;
+   //
+   // piece lists give the same hash as a board scan, xor does not depend on order
+   for(int side=0; side<2; ++side)
+   {
+      PieceColor color = side ? pcBlack : pcWhite;
+      for(PieceType type=ptFirst; type<=ptLast; ++type)
+      {
+         int kind = (type-ptFirst) + side*6;
+         for(unsigned i=0; i<position.pieceCount(color, type); ++i)
+         {
+            ChessCoord coord = position.pieceCoord(color, type, i);
+            int cell = ((coord.row-1)*8 + (coord.col-1)) % cBoardCells;
+            hash ^= k.pieces[kind][cell];
+         }
+      }
+   }
+   //
+   unsigned castling = position.castlingFlags();
+   for(int i=0; i<4; ++i)
+   {
+      if(castling & (1<<i)) hash ^= k.castling[i];
+   }
+   //
+   ChessCoord pawnJump = position.pawnJump();
+   if(pawnJump!=ChessCoord()) hash ^= k.enPassant[(pawnJump.col-1) & 7];
+   //
+   if(position.sideToMove()==pcBlack) hash ^= k.blackToMove;
+   //
+   return hash;
+}
@@ -0,0 +1,16 @@
+#ifndef __PositionHash_h
+#define __PositionHash_h
+
+#include "ChessPosition.h"
+
+#include <QtGlobal>
+
+// 64-bit Zobrist hash of a position: pieces, side to move, castling rights
+// and en passant file (move counters are not included, so transpositions
+// reached at different move numbers have the same hash);
+// the keys are generated from a fixed seed, hash values are therefore
+// stable between program runs and can be stored in files
+
+quint64 positionHash(const ChessPosition& position);
+
+#endif
@@ -0,0 +1,205 @@
+#include "PositionIndex.h"
+#include "PositionHash.h"
+#include "GameSessionInfo.h"
+#include "ChessRules.h"
+#include "StringUtils.h"
+
+#include <QFileInfo>
+
+#include <algorithm>
+#include <string.h>
+
+namespace
+{
+
+const char cIndexSignature[] = "K3PX";
+const quint32 cIndexVersion = 2;
+
+// fixed size header, entries follow it
+struct IndexHeader
+{
+   char signature[4];
+   quint32 version;
+   qint64 collectionSize;    // the index is valid only for the very same collection file
+   qint64 collectionModified; // ms since the epoch
+   quint32 count;
+   quint32 entrySize;
+   quint32 reserved;
+};
+
+bool fillHeader(IndexHeader& header, const QString& collectionFileName)
+{
+   QFileInfo info(collectionFileName);
+   if(!info.exists()) return false;
+   //
+   memset(&header, 0, sizeof(header));
+   memcpy(header.signature, cIndexSignature, sizeof(header.signature));
+   header.version = cIndexVersion;
+   header.collectionSize = info.size();
+   header.collectionModified = fileModificationTime(info);
+   header.entrySize = sizeof(PositionIndexEntry);
+   return true;
+}
+
+struct HashLess
+{
+   bool operator()(const PositionIndexEntry& e, quint64 hash) const { return e.hash<hash; }
+   bool operator()(quint64 hash, const PositionIndexEntry& e) const { return hash<e.hash; }
+};
+
+}
+
+PositionIndex::PositionIndex() : data_(0), entries_(0), count_(0)
+{
+}
+
+PositionIndex::~PositionIndex()
+{
+   close();
+}
+
+QString PositionIndex::indexFileName(const QString& collectionFileName)
+{
+   return collectionFileName + ".pos";
+}
+
+bool PositionIndex::build(const QString& collectionFileName)
+{
+   IndexHeader header;
+   if(!fillHeader(header, collectionFileName)) return false;
+   //
+   std::vector<GameSessionInfo> games;
+   if(!GameSessionInfo::loadCollection(collectionFileName, games)) return false;
+   //
+   unsigned nEntries = 0;
+   for(unsigned i=0; i<games.size(); ++i) nEntries += games[i].moves.size()+1;
+   //
+   std::vector<PositionIndexEntry> entries;
+   entries.reserve(nEntries);
+   //
+   PositionIndexEntry e;
+   e.reserved = 0;
+   for(unsigned i=0; i<games.size(); ++i)
+   {
+      const GameSessionInfo& game = games[i];
+      ChessPosition position = game.initialPosition;
+      e.game = i;
+      //
+      unsigned nPlies = qMin(game.moves.size(), (size_t)0xFFFF);
+      for(unsigned ply=0; ; ++ply)
+      {
+         e.hash = positionHash(position);
+         e.ply = ply;
+         entries.push_back(e);
+         if(ply==nPlies) break;
+         // moves were validated on import
+         g_chessRules.applyMove(position, game.moves[ply]);
+      }
+      //
+      // free the memory as early as possible, the entry table is large enough
+      std::vector<ChessMove>().swap(games[i].moves);
+   }
+   games.clear();
+   //
+   std::sort(entries.begin(), entries.end());
+   //
+   // only the first occurrence of a position in a game is of interest
+   // (repetitions, transpositions within the same game)
+   unsigned n = 0;
+   for(unsigned i=0; i<entries.size(); ++i)
+   {
+      if(n>0 && entries[n-1].hash==entries[i].hash &&
+                entries[n-1].game==entries[i].game) continue;
+      entries[n++] = entries[i];
+   }
+   entries.resize(n);
+   header.count = n;
+   //
+   QFile file(indexFileName(collectionFileName));
+   if(!file.open(QIODevice::WriteOnly|QIODevice::Truncate)) return false;
+   //
+   qint64 dataSize = (qint64)n*sizeof(PositionIndexEntry);
+   bool ok = file.write((const char *)&header, sizeof(header))==sizeof(header) &&
+             (n==0 || file.write((const char *)&entries[0], dataSize)==dataSize);
+   file.close();
+   //
+   if(!ok) file.remove();
+   return ok;
+}
+
+bool PositionIndex::open(const QString& collectionFileName)
+{
+   close();
+   //
+   IndexHeader expected;
+   if(!fillHeader(expected, collectionFileName)) return false;
+   //
+   file_.setFileName(indexFileName(collectionFileName));
+   if(!file_.open(QIODevice::ReadOnly)) return false;
+   //
+   qint64 size = file_.size();
+   if(size<(qint64)sizeof(IndexHeader) ||
+      (data_ = file_.map(0, size))==0)
+   {
+      close();
+      return false;
+   }
+   //
+   IndexHeader header;
+   memcpy(&header, data_, sizeof(header));
+   expected.count = header.count;
+   //
+   if(memcmp(&header, &expected, sizeof(header))!=0 ||
+      size!=(qint64)sizeof(header)+(qint64)header.count*sizeof(PositionIndexEntry))
+   {
+      close();
+      return false;
+   }
+   //
+   collectionFileName_ = collectionFileName;
+   entries_ = (const PositionIndexEntry *)(data_ + sizeof(header));
+   count_ = header.count;
+   return true;
+}
+
+void PositionIndex::close()
+{
+   if(data_)
+   {
+      file_.unmap((uchar *)data_);
+      data_ = 0;
+   }
+   file_.close();
+   entries_ = 0;
+   count_ = 0;
+   collectionFileName_.clear();
+}
+
+bool PositionIndex::isOpen() const
+{
+   return data_!=0;
+}
+
+const QString& PositionIndex::collectionFileName() const
+{
+   return collectionFileName_;
+}
+
+unsigned PositionIndex::entryCount() const
+{
+   return count_;
+}
+
+unsigned PositionIndex::find(quint64 hash, std::vector<PositionIndexEntry>& entries,
+                             unsigned maxEntries) const
+{
+   entries.clear();
+   if(!entries_) return 0;
+   //
+   std::pair<const PositionIndexEntry *, const PositionIndexEntry *> range =
+         std::equal_range(entries_, entries_+count_, hash, HashLess());
+   //
+   unsigned nFound = range.second-range.first;
+   entries.assign(range.first, range.first+qMin(nFound, maxEntries));
+   return nFound;
+}
@@ -0,0 +1,64 @@
+#ifndef __PositionIndex_h
+#define __PositionIndex_h
+
+#include <QFile>
+#include <QString>
+
+#include <vector>
+
+// single occurrence of a position in the game collection
+struct PositionIndexEntry
+{
+   quint64 hash;    // see positionHash()
+   quint32 game;    // zero-based index of the game in the collection
+   quint16 ply;     // number of half moves played before the position
+   quint16 reserved;
+   //
+   bool operator<(const PositionIndexEntry& e) const
+   {
+      if(hash!=e.hash) return hash<e.hash;
+      if(game!=e.game) return game<e.game;
+      return ply<e.ply;
+   }
+};
+
+// PositionIndex answers "which games reached this position" for the
+// binary game collection: every position of every game is hashed once,
+// the entries are sorted by hash and written to a file next to the
+// collection; the file is memory-mapped and searched with binary search,
+// so a lookup only touches a few pages of it
+// (entries are stored in native byte order, the file is a local cache
+// and is rebuilt whenever the collection changes)
+
+class PositionIndex
+{
+public:
+   PositionIndex();
+   ~PositionIndex();
+
+   static bool build(const QString& collectionFileName); // creates or replaces the index file
+
+   bool open(const QString& collectionFileName); // fails if the index is missing or outdated
+   void close();
+   bool isOpen() const;
+
+   const QString& collectionFileName() const;
+
+   unsigned entryCount() const;
+
+   // finds games which reached the position with the given hash (first occurrence in
+   // each game, in collection order); returns the total number of such games
+   unsigned find(quint64 hash, std::vector<PositionIndexEntry>& entries,
+                 unsigned maxEntries) const;
+
+   static QString indexFileName(const QString& collectionFileName);
+
+private:
+   QString collectionFileName_;
+   QFile file_;
+   const uchar *data_;
+   const PositionIndexEntry *entries_;
+   unsigned count_;
+};
+
+#endif
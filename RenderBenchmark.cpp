@@ -0,0 +1,332 @@
+// K3ChessBenchmark: renders the board and side panels offscreen into
+// images and reports paint timings, so that rendering changes can be
+// compared without a device (build with K3Chess.benchmark.pro)
+//
+// usage: K3ChessBenchmark [iterations]
+
+#include "Singletons.h"
+#include "ChessBoardView.h"
+#include "CapturedPiecesView.h"
+#include "MoveListView.h"
+#include "CommandPanel.h"
+#include "CommandOptionDefs.h"
+#include "ChessRules.h"
+#include "Settings.h"
+#include "RepaintScheduler.h"
+#include "PieceSpriteCache.h"
+
+#include <QApplication>
+#include <QImage>
+#include <QTime>
+#include <QTextStream>
+#include <QStringList>
+
+namespace
+{
+
+const int cDefaultIterations = 100;
+const int cBoardSizes[] = { 320, 600, 824 };
+const int cPanelWidths[] = { 320, 600 };
+
+// 1.e4 e5 2.Nf3 Nc6 3.Bb5 a6 4.Bxc6 dxc6, white to move
+const char *cGameMoves[] = { "e2e4", "e7e5", "g1f3", "b8c6", "f1b5", "a7a6", "b5c6", "d7c6" };
+const char *cGameSan[] = { "e4", "e5", "Nf3", "Nc6", "Bb5", "a6", "Bxc6", "dxc6" };
+const char *cBenchMove = "f3e5"; // applied and taken back in the "move" operation
+
+QTextStream out(stdout);
+
+struct Sample
+{
+   ChessPosition position;
+   CoordPair lastMove;
+   ChessMoveMap possibleMoves;
+};
+
+Sample makeSample(const ChessPosition& from, const char *const *moves, unsigned nMoves)
+{
+   Sample sample;
+   sample.position = from;
+   for(unsigned i=0; i<nMoves; ++i)
+   {
+      ChessMove move = ChessMove::fromString(moves[i]);
+      g_chessRules.applyMove(sample.position, move);
+      sample.lastMove = move;
+   }
+   g_chessRules.findPossibleMoves(sample.position, sample.possibleMoves);
+   return sample;
+}
+
+// shown with WA_DontShowOnScreen, so widgets are polished and laid out
+// as usual but never appear on the screen
+void prepareWidget(QWidget& widget, int width, int height)
+{
+   widget.setAttribute(Qt::WA_DontShowOnScreen);
+   widget.resize(width, height);
+   widget.show();
+   qApp->processEvents();
+}
+
+// renders only the region the widget asked to repaint since the last call
+void renderPending(QWidget& widget, QImage& image)
+{
+   QRegion region = g_repaintScheduler.takeRegion(&widget);
+   if(!region.isEmpty()) widget.render(&image, QPoint(), region);
+}
+
+double usPerIteration(const QTime& timer, int iterations)
+{
+   return timer.elapsed()*1000.0/iterations;
+}
+
+void printHeader(const QString& title)
+{
+   out << "\n" << title << "\n";
+   out.flush();
+}
+
+void printResult(const QString& name, double first, double frame,
+                 const QString& operation=QString(), double opTime=0)
+{
+   out << qSetFieldWidth(40) << left << name << qSetFieldWidth(0)
+       << QString(" first %1 ms  frame %2 us").arg(first, 7, 'f', 1).arg(frame, 8, 'f', 0);
+   if(!operation.isEmpty())
+   {
+      out << QString("  %1 %2 us").arg(operation).arg(opTime, 8, 'f', 0);
+   }
+   out << "\n";
+   out.flush();
+}
+
+void benchmarkBoard(const QString& styleName, const QString& style, int size,
+                    bool coords, bool arrow, bool hints, bool flipped,
+                    const Sample& sample, const Sample& afterMove, int iterations)
+{
+   QString name = QString("%1 %2 %3%4%5%6").arg(styleName).arg(size).
+         arg(coords ? "C" : "-").arg(arrow ? "A" : "-").arg(hints ? "H" : "-").arg(flipped ? "F" : "-");
+   //
+   QImage image(size, size, QImage::Format_ARGB32_Premultiplied);
+   //
+   // the first frame includes loading (or scaling) the pieces atlas
+   // and drawing the whole board image
+   g_pieceSprites.clear();
+   QTime timer;
+   timer.start();
+   //
+   ChessBoardView view(0);
+   view.setPiecesStyle(style);
+   view.setDrawCoords(coords);
+   view.setDrawMoveArrow(arrow);
+   view.setShowMoveHints(hints);
+   view.setFlipped(flipped);
+   view.updatePosition(sample.position, sample.lastMove, sample.possibleMoves);
+   prepareWidget(view, size, size);
+   view.render(&image);
+   g_repaintScheduler.takeRegion(&view);
+   double first = timer.elapsed();
+   //
+   if(hints)
+   {
+      // select the knight on f3, its targets are marked with hints
+      view.setInitialCursorPos(ChessCoord(6, 3));
+      view.beginMoveSelection();
+      view.processKey(Qt::Key_Select);
+      view.render(&image);
+      g_repaintScheduler.takeRegion(&view);
+   }
+   //
+   timer.start();
+   for(int i=0; i<iterations; ++i) view.render(&image);
+   double frame = usPerIteration(timer, iterations);
+   //
+   QString operation;
+   timer.start();
+   if(hints)
+   {
+      // cursor over the target cells of the selected piece
+      operation = "cursor";
+      for(int i=0; i<iterations; ++i)
+      {
+         view.processKey(i%2 ? Qt::Key_Left : Qt::Key_Right);
+         renderPending(view, image);
+      }
+   }
+   else
+   {
+      // a move and its takeback, only changed squares are painted
+      operation = "move";
+      for(int i=0; i<iterations; ++i)
+      {
+         const Sample& s = i%2 ? sample : afterMove;
+         view.updatePosition(s.position, s.lastMove, s.possibleMoves);
+         renderPending(view, image);
+      }
+   }
+   double opTime = usPerIteration(timer, iterations);
+   //
+   printResult(name, first, frame, operation, opTime);
+}
+
+void benchmarkCapturedPieces(const QString& styleName, const QString& style, int width,
+                             const Sample& sample, int iterations)
+{
+   QString name = QString("%1 %2").arg(styleName).arg(width);
+   int height = width/11;
+   QImage image(width, height, QImage::Format_ARGB32_Premultiplied);
+   //
+   g_pieceSprites.clear();
+   QTime timer;
+   timer.start();
+   //
+   CapturedPiecesView view;
+   view.setPiecesStyle(style);
+   prepareWidget(view, width, height);
+   view.updateContents(cStandardInitialPosition, sample.position);
+   view.render(&image);
+   g_repaintScheduler.takeRegion(&view);
+   double first = timer.elapsed();
+   //
+   timer.start();
+   for(int i=0; i<iterations; ++i) view.render(&image);
+   double frame = usPerIteration(timer, iterations);
+   //
+   timer.start();
+   for(int i=0; i<iterations; ++i)
+   {
+      view.updateContents(cStandardInitialPosition, i%2 ? sample.position : cStandardInitialPosition);
+      renderPending(view, image);
+   }
+   double opTime = usPerIteration(timer, iterations);
+   //
+   printResult(name, first, frame, "update", opTime);
+}
+
+void benchmarkMoveList(int width, int iterations)
+{
+   int height = width*3/4;
+   QImage image(width, height, QImage::Format_ARGB32_Premultiplied);
+   //
+   QStringList moves;
+   for(int i=0; i<15; ++i)
+   {
+      for(unsigned j=0; j<sizeof(cGameSan)/sizeof(cGameSan[0]); ++j) moves.append(cGameSan[j]);
+   }
+   //
+   QTime timer;
+   timer.start();
+   //
+   MoveListView view;
+   prepareWidget(view, width, height);
+   view.addMoves(moves);
+   view.render(&image);
+   double first = timer.elapsed();
+   //
+   timer.start();
+   for(int i=0; i<iterations; ++i) view.render(&image);
+   double frame = usPerIteration(timer, iterations);
+   //
+   // the view repaints its viewport, so the whole view is rendered
+   timer.start();
+   for(int i=0; i<iterations; ++i)
+   {
+      if(i%2) view.dropMoves(1);
+      else view.addMove("Nxe5");
+      view.render(&image);
+   }
+   double opTime = usPerIteration(timer, iterations);
+   //
+   printResult(QString("%1 moves %2").arg(moves.size()).arg(width), first, frame, "add/drop", opTime);
+}
+
+void benchmarkCommandPanel(int width, int iterations)
+{
+   int height = width/4;
+   QImage image(width, height, QImage::Format_ARGB32_Premultiplied);
+   //
+   QTime timer;
+   timer.start();
+   //
+   CommandPanel panel;
+   prepareWidget(panel, width, height);
+   panel.setCommandOptions(g_commandOptionDefs.extMenuOptions());
+   panel.render(&image);
+   double first = timer.elapsed();
+   //
+   timer.start();
+   for(int i=0; i<iterations; ++i) panel.render(&image);
+   double frame = usPerIteration(timer, iterations);
+   //
+   timer.start();
+   for(int i=0; i<iterations; ++i)
+   {
+      panel.setCommandOptions(i%2 ? g_commandOptionDefs.extMenuOptions() :
+                                    g_commandOptionDefs.inGameOptions());
+      panel.render(&image);
+   }
+   double opTime = usPerIteration(timer, iterations);
+   //
+   printResult(QString("command panel %1").arg(width), first, frame, "options", opTime);
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+   QApplication app(argc, argv);
+   app.setApplicationName("K3Chess");
+   //
+   Singletons::initialize();
+   //
+   QStringList args = app.arguments();
+   int iterations = args.size()>1 ? args[1].toInt() : cDefaultIterations;
+   if(iterations<=0) iterations = cDefaultIterations;
+   //
+   unsigned nGameMoves = sizeof(cGameMoves)/sizeof(cGameMoves[0]);
+   Sample sample = makeSample(cStandardInitialPosition, cGameMoves, nGameMoves);
+   Sample afterMove = makeSample(sample.position, &cBenchMove, 1);
+   //
+   out << "iterations per measurement: " << iterations << "\n";
+   out << "board options: C - coordinates, A - move arrow, H - move hints (cursor test), F - flipped\n";
+   //
+   QStringList styles = g_settings.getPiecesStyleNames();
+   //
+   printHeader("ChessBoardView");
+   foreach(QString styleName, styles)
+   {
+      QString style = g_settings.pieceImageFileFromName(styleName);
+      for(unsigned i=0; i<sizeof(cBoardSizes)/sizeof(cBoardSizes[0]); ++i)
+      {
+         for(int options=0; options<16; ++options)
+         {
+            benchmarkBoard(styleName, style, cBoardSizes[i],
+                           options & 1, options & 2, options & 4, options & 8,
+                           sample, afterMove, iterations);
+         }
+      }
+   }
+   //
+   printHeader("CapturedPiecesView");
+   foreach(QString styleName, styles)
+   {
+      QString style = g_settings.pieceImageFileFromName(styleName);
+      for(unsigned i=0; i<sizeof(cPanelWidths)/sizeof(cPanelWidths[0]); ++i)
+      {
+         benchmarkCapturedPieces(styleName, style, cPanelWidths[i], sample, iterations);
+      }
+   }
+   //
+   printHeader("MoveListView");
+   for(unsigned i=0; i<sizeof(cPanelWidths)/sizeof(cPanelWidths[0]); ++i)
+   {
+      benchmarkMoveList(cPanelWidths[i], iterations);
+   }
+   //
+   printHeader("CommandPanel");
+   for(unsigned i=0; i<sizeof(cPanelWidths)/sizeof(cPanelWidths[0]); ++i)
+   {
+      benchmarkCommandPanel(cPanelWidths[i], iterations);
+   }
+   //
+   Singletons::finalize();
+   //
+   return 0;
+}
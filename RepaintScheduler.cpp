@@ -0,0 +1,134 @@
+#include "RepaintScheduler.h"
+
+#include <QWidget>
+
+#include <set>
+
+RepaintScheduler::RepaintScheduler() :
+   fullRefreshInterval_(0), movesSinceFullRefresh_(0), fullRefreshDue_(false),
+   refreshCount_(0), fullRefreshCount_(0),
+   moveRefreshCount_(0), lastMoveRefreshCount_(0)
+{
+   timer_.setSingleShot(true);
+   timer_.setInterval(0); // fires once pending events of the current action are processed
+   QObject::connect(&timer_, SIGNAL(timeout()), this, SLOT(flush()));
+}
+
+RepaintScheduler::~RepaintScheduler()
+{
+}
+
+void RepaintScheduler::schedule(QWidget *widget, const QRegion& region)
+{
+   if(!widget || region.isEmpty()) return;
+   //
+   PendingMap::iterator it = pending_.find(widget);
+   if(it==pending_.end())
+   {
+      QObject::connect(widget, SIGNAL(destroyed(QObject*)), this, SLOT(widgetDestroyed(QObject*)), Qt::UniqueConnection);
+      pending_[widget] = region;
+   }
+   else
+   {
+      it->second += region;
+   }
+   //
+   if(!timer_.isActive()) timer_.start();
+}
+
+void RepaintScheduler::schedule(QWidget *widget)
+{
+   if(widget) schedule(widget, QRegion(widget->rect()));
+}
+
+QRegion RepaintScheduler::takeRegion(QWidget *widget)
+{
+   PendingMap::iterator it = pending_.find(widget);
+   if(it==pending_.end()) return QRegion();
+   //
+   QRegion region = it->second;
+   pending_.erase(it);
+   return region;
+}
+
+void RepaintScheduler::flush()
+{
+   timer_.stop();
+   if(pending_.empty()) return;
+   //
+   ++refreshCount_;
+   ++moveRefreshCount_;
+   //
+   if(fullRefreshDue_)
+   {
+      // the screen driver flashes the panel when the whole window is updated
+      std::set<QWidget *> windows;
+      for(PendingMap::iterator it=pending_.begin(); it!=pending_.end(); ++it)
+      {
+         windows.insert(it->first->window());
+      }
+      for(std::set<QWidget *>::iterator it=windows.begin(); it!=windows.end(); ++it)
+      {
+         (*it)->update();
+      }
+      fullRefreshDue_ = false;
+      ++fullRefreshCount_;
+   }
+   else
+   {
+      // update() instead of repaint(): Qt paints all dirty widgets
+      // of a window in a single pass and flushes them to the screen at once
+      for(PendingMap::iterator it=pending_.begin(); it!=pending_.end(); ++it)
+      {
+         it->first->update(it->second);
+      }
+   }
+   //
+   pending_.clear();
+}
+
+void RepaintScheduler::widgetDestroyed(QObject *object)
+{
+   for(PendingMap::iterator it=pending_.begin(); it!=pending_.end(); ++it)
+   {
+      if(static_cast<QObject *>(it->first)==object)
+      {
+         pending_.erase(it);
+         break;
+      }
+   }
+}
+
+void RepaintScheduler::setFullRefreshInterval(unsigned n)
+{
+   fullRefreshInterval_ = n;
+   movesSinceFullRefresh_ = 0;
+   fullRefreshDue_ = false;
+}
+
+void RepaintScheduler::moveCompleted()
+{
+   lastMoveRefreshCount_ = moveRefreshCount_;
+   moveRefreshCount_ = 0;
+   //
+   if(fullRefreshInterval_>0 && ++movesSinceFullRefresh_>=fullRefreshInterval_)
+   {
+      movesSinceFullRefresh_ = 0;
+      fullRefreshDue_ = true;
+   }
+}
+
+unsigned RepaintScheduler::refreshCount() const
+{
+   return refreshCount_;
+}
+
+unsigned RepaintScheduler::fullRefreshCount() const
+{
+   return fullRefreshCount_;
+}
+
+unsigned RepaintScheduler::lastMoveRefreshCount() const
+{
+   return lastMoveRefreshCount_;
+}
@@ -0,0 +1,63 @@
+#ifndef __RepaintScheduler_h
+#define __RepaintScheduler_h
+
+#include "Singletons.h"
+
+#include <QObject>
+#include <QTimer>
+#include <QRegion>
+
+#include <map>
+
+class QWidget;
+
+// RepaintScheduler collects repaint requests of the views and paints
+// them together once control returns to the event loop, so a single user
+// action or move results in a single screen refresh instead of one per
+// repaint() call; the refresh following every n-th move repaints whole
+// windows to clear e-ink ghosting (see K3ChessSettings::fullRefreshInterval()),
+// so clock ticks and cursor movement do not make the panel flash
+
+class RepaintScheduler : public QObject
+{
+   Q_OBJECT
+
+   friend void Singletons::initialize();
+   friend void Singletons::finalize();
+
+   RepaintScheduler();
+   ~RepaintScheduler();
+
+public:
+   void schedule(QWidget *widget, const QRegion& region);
+   void schedule(QWidget *widget); // the whole widget
+   QRegion takeRegion(QWidget *widget); // removes the widget's pending region (e.g. to render it offscreen)
+   //
+   void setFullRefreshInterval(unsigned n); // 0 means partial refreshes only
+   void moveCompleted();                    // counts moves towards a full refresh and starts counting refreshes of the next move
+   //
+   unsigned refreshCount() const;           // since program start
+   unsigned fullRefreshCount() const;
+   unsigned lastMoveRefreshCount() const;   // refreshes between the last two moveCompleted() calls
+
+public slots:
+   void flush(); // paints scheduled regions now
+
+private slots:
+   void widgetDestroyed(QObject *object);
+
+private:
+   typedef std::map<QWidget *, QRegion> PendingMap;
+   //
+   PendingMap pending_;
+   QTimer timer_;
+   unsigned fullRefreshInterval_;
+   unsigned movesSinceFullRefresh_;
+   bool fullRefreshDue_;        // the next flush repaints whole windows
+   unsigned refreshCount_;
+   unsigned fullRefreshCount_;
+   unsigned moveRefreshCount_;  // of the current move
+   unsigned lastMoveRefreshCount_;
+};
+
+#endif
@@ -6,6 +6,9 @@
 
 #include <QTime>
 #include <QTextCodec>
+#include <QTextStream>
+#include <QFile>
+#include <QDataStream>
 
 // @@note: you can override default locale ("English")
 // by providing a file named "English.ini" in locales directory
@@ -20,11 +23,27 @@ const QString cDefaultPlayerClockSetup = "15 0";
 const QString cDefaultEngineClockSetup = "5 0";
 const QString cDefaultPgnFilePath = "./games.pgn";
 const QString cDefaultLastGameFile = "./lastgame.dat";
+const QString cDefaultLastGameJournalFile = "./lastgame.jnl";
+const QString cDefaultGameCollectionFile = "./games.k3g";
+const QString cDefaultOpeningBookFile = "./books/book.bin";
+const QString cDefaultPolyglotKeysFile = "./books/polyglot_keys.txt";
+const QString cDefaultSyzygyPath = "./syzygy";
+const QString cDefaultSpriteCacheDir = "./cache";
 const QString cDefaultPlayerName = "Player";
 const QString cDefaultLocaleName = "English";
+const QString cDiscoveryIndexFile = "./discovery.idx";
 const QString cDefaultPgnEventName = "K3Chess game";
 const QString cDefaultSiteName = "?";
 const int cDefaultBoardMargins = 16;
+#ifdef CONFIG_DEVICE
+const unsigned cDefaultFullRefreshInterval = 12;
+const unsigned cDefaultSpriteGrayLevels = 16; // e-ink panel
+const bool cDefaultDitherSprites = false;
+#else
+const unsigned cDefaultFullRefreshInterval = 0;
+const unsigned cDefaultSpriteGrayLevels = 0;
+const bool cDefaultDitherSprites = false;
+#endif
 
 bool containsDigits(const QString& s)
 {
@@ -78,6 +97,61 @@ ChessClock stringToClock(const QString& s)
    return clock;
 }
 
+// directory enumeration filters (see DiscoveryIndex)
+
+bool isEngineIniFile(const QString& fileName)
+{
+   return fileName=="engine.ini";
+}
+
+bool isPieceImageFile(const QString& fileName)
+{
+   if(!fileName.contains('.')) return false;
+   QString ext = fileName.section('.', -1, -1);
+   return ext=="png" || ext=="bmp" || ext=="jpg";
+}
+
+bool isLocaleIniFile(const QString& fileName)
+{
+   return fileName.endsWith(".ini");
+}
+
+// parsed engine descriptions are stored in the discovery index
+
+QDataStream& operator<<(QDataStream& out, const EngineInfo& info)
+{
+   out << info.name << info.exePath << (qint32)info.type
+       << info.profileNames << info.cleanUpMasks
+       << info.commandStandard << info.command960;
+   //
+   out << (quint32)info.startupCommands.size();
+   std::map<QString, QStringList>::const_iterator it = info.startupCommands.begin();
+   for(; it!=info.startupCommands.end(); ++it)
+   {
+      out << it->first << it->second;
+   }
+   return out;
+}
+
+QDataStream& operator>>(QDataStream& in, EngineInfo& info)
+{
+   qint32 type = etDetect;
+   in >> info.name >> info.exePath >> type
+      >> info.profileNames >> info.cleanUpMasks
+      >> info.commandStandard >> info.command960;
+   info.type = EngineType(type);
+   //
+   quint32 nProfiles = 0;
+   in >> nProfiles;
+   for(quint32 i=0; i<nProfiles && in.status()==QDataStream::Ok; ++i)
+   {
+      QString profileName;
+      in >> profileName;
+      in >> info.startupCommands[profileName];
+   }
+   return in;
+}
+
 }
 
 Profile Profile::fromString(const QString& str)
@@ -93,31 +167,81 @@ bool Profile::contains(const QString& str) const
 }
 
 K3ChessSettings::K3ChessSettings() :
-   settings_(cK3ChessIniPath, QSettings::IniFormat)
+   settings_(cK3ChessIniPath, QSettings::IniFormat),
+   discovery_(cDiscoveryIndexFile),
+   enginesEnumerated_(false), piecesStylesEnumerated_(false), localesEnumerated_(false)
 {
    settings_.setIniCodec(QTextCodec::codecForName("UTF-8"));
    //
    profile_ = Profile::fromString(settings_.value("Profile", "Default").toString());
-   // enumerate engines (must have "engine.ini"-files with descriptions)
-   enumEngines(QDir("./engines"));
-   enumPiecesStyles(QDir("./pieces"));
-   enumLocales(QDir("./locales"));
+   loadSnapshot();
+   //
+   // engines, pieces styles and locales are enumerated on first use
+   // (see engines(), piecesStyles() and locales()), engines usually only
+   // after the board has been shown
 }
 
 K3ChessSettings::~K3ChessSettings()
 {
+   flush();
+}
+
+void K3ChessSettings::loadSnapshot()
+{
+   values_.engineName = settings_.value("Engine", QString()).toString();
+   values_.engineProfile = settings_.value("EngineProfile", "Default").toString();
+   values_.piecesStyle = settings_.value("Board/PiecesStyle", QString()).toString();
+   values_.localeName = settings_.value("Locale", cDefaultLocaleName).toString();
+   values_.pgnFilePath = settings_.value("Export/PGNFile", cDefaultPgnFilePath).toString();
+   values_.pgnDatabaseFile = settings_.value("Database/PGNFile", values_.pgnFilePath).toString();
+   values_.gameCollectionFile = settings_.value("Database/GamesFile", cDefaultGameCollectionFile).toString();
+   values_.openingBookFile = settings_.value("Book/File", cDefaultOpeningBookFile).toString();
+   values_.polyglotKeysFile = settings_.value("Book/KeysFile", cDefaultPolyglotKeysFile).toString();
+   values_.useOpeningBook = settings_.value("Book/UseBook", true).toBool();
+   values_.syzygyPath = settings_.value("Tablebases/SyzygyPath", cDefaultSyzygyPath).toString();
+   values_.adjudicateByTablebases = settings_.value("Tablebases/Adjudicate", true).toBool();
+   values_.playerName = settings_.value("PlayerName", cDefaultPlayerName).toString();
+   values_.playerClock = settings_.value("Game/PlayerClock", cDefaultPlayerClockSetup).toString();
+   values_.engineClock = settings_.value("Game/EngineClock", cDefaultEngineClockSetup).toString();
+   values_.initialPositionFen = settings_.value("InitialPosition", QString(cStandardInitialFen.c_str())).toString();
+   values_.boardMargins = settings_.value("Board/Margins", cDefaultBoardMargins).toInt();
+   values_.drawCoordinates = settings_.value("Board/DrawCoordinates", true).toBool();
+   values_.drawMoveArrow = settings_.value("Board/DrawMoveArrow", true).toBool();
+   values_.showMoveHints = settings_.value("Board/ShowMoveHints", true).toBool();
+   values_.showGameClock = settings_.value("ShowGameClock", false).toBool();
+   values_.showCapturedPieces = settings_.value("ShowCapturedPieces", false).toBool();
+   values_.coordinateMoveInput = settings_.value("CoordinateMoveInput", false).toBool();
+   values_.quickSingleMoveSelection = settings_.value("QuickSingleMoveSelection", true).toBool();
+   values_.keyColumnSelect = settings_.value("Input/KeyCoordSelect", true).toBool();
+   values_.keyPieceSelect = settings_.value("Input/KeyPieceSelect", true).toBool();
+   values_.autoSaveGames = settings_.value("Misc/AutoSaveGames", false).toBool();
+   values_.canPonder = settings_.value("Game/Pondering", false).toBool();
+   values_.chess960 = settings_.value("Chess960", false).toBool();
+   values_.useRussianNotation = settings_.value("UseRussianNotation", false).toBool();
+   values_.showOpeningExplorer = settings_.value("Database/ShowExplorer", false).toBool();
+   values_.spriteCacheDir = settings_.value("Board/SpriteCacheDir", cDefaultSpriteCacheDir).toString();
+   values_.spriteGrayLevels = settings_.value("Board/SpriteGrayLevels", cDefaultSpriteGrayLevels).toUInt();
+   values_.ditherSprites = settings_.value("Board/DitherSprites", cDefaultDitherSprites).toBool();
+   values_.fullRefreshInterval = settings_.value("Display/FullRefreshInterval", cDefaultFullRefreshInterval).toUInt();
+   //
+   playerClock_ = stringToClock(values_.playerClock);
+   engineClock_ = stringToClock(values_.engineClock);
+}
 
+void K3ChessSettings::storeValue(const QString& key, const QVariant& value)
+{
+   pendingValues_[key] = value;
 }
 
 const EngineInfo& K3ChessSettings::engineInfo() const
 {
-   QString name = settings_.value("Engine", QString()).toString();
-   std::map<QString, EngineInfo>::const_iterator it = engines_.find(name);
-   if(it==engines_.end())
+   const EngineMap& engines = this->engines();
+   EngineMap::const_iterator it = engines.find(values_.engineName);
+   if(it==engines.end())
    {
       static const EngineInfo dummy;
-      if(engines_.empty()) return dummy;
-      return engines_.begin()->second;
+      if(engines.empty()) return dummy;
+      return engines.begin()->second; // stored engine is no longer installed
    }
    else
       return it->second;
@@ -125,11 +249,13 @@ const EngineInfo& K3ChessSettings::engineInfo() const
 
 QString K3ChessSettings::localeName() const
 {
-   QString name = settings_.value("Locale", cDefaultLocaleName).toString();
-   if(locales_.find(name)==locales_.end())
+   const QString& name = values_.localeName;
+   const NameMap& locales = this->locales();
+   if(locales.find(name)==locales.end())
    {
-      if(locales_.empty()) return cDefaultLocaleName;
-      return locales_.begin()->first;
+      if(locales.empty() || locales.find(cDefaultLocaleName)!=locales.end())
+         return cDefaultLocaleName;
+      return locales.begin()->first;
    }
    else
       return name;
@@ -137,11 +263,12 @@ QString K3ChessSettings::localeName() const
 
 QString K3ChessSettings::piecesStyle() const
 {
-   QString name = settings_.value("Board/PiecesStyle", QString()).toString();
-   if(piecesStyles_.find(name)==piecesStyles_.end())
+   const QString& name = values_.piecesStyle;
+   const NameMap& piecesStyles = this->piecesStyles();
+   if(piecesStyles.find(name)==piecesStyles.end())
    {
-      if(piecesStyles_.empty()) return QString();
-      return piecesStyles_.begin()->first;
+      if(piecesStyles.empty()) return QString();
+      return piecesStyles.begin()->first;
    }
    else
       return name;
@@ -159,62 +286,97 @@ QString K3ChessSettings::localeIniFilePath() const
 
 QString K3ChessSettings::pgnFilePath() const
 {
-   return settings_.value("Export/PGNFile", cDefaultPgnFilePath).toString();
+   return values_.pgnFilePath;
+}
+
+QString K3ChessSettings::pgnDatabaseFile() const
+{
+   return values_.pgnDatabaseFile;
+}
+
+QString K3ChessSettings::gameCollectionFile() const
+{
+   return values_.gameCollectionFile;
+}
+
+QString K3ChessSettings::openingBookFile() const
+{
+   return values_.openingBookFile;
+}
+
+QString K3ChessSettings::polyglotKeysFile() const
+{
+   return values_.polyglotKeysFile;
+}
+
+bool K3ChessSettings::useOpeningBook() const
+{
+   return values_.useOpeningBook;
+}
+
+QString K3ChessSettings::syzygyPath() const
+{
+   return values_.syzygyPath;
+}
+
+bool K3ChessSettings::adjudicateByTablebases() const
+{
+   return values_.adjudicateByTablebases;
 }
 
 QString K3ChessSettings::playerName() const
 {
-   return settings_.value("PlayerName", cDefaultPlayerName).toString();
+   return values_.playerName;
 }
 
 bool K3ChessSettings::drawMoveArrow() const
 {
-   return settings_.value("Board/DrawMoveArrow", true).toBool();
+   return values_.drawMoveArrow;
 }
 
 bool K3ChessSettings::drawCoordinates() const
 {
-   return settings_.value("Board/DrawCoordinates", true).toBool();
+   return values_.drawCoordinates;
 }
 
 ChessClock K3ChessSettings::playerClock() const
 {
-   return stringToClock(playerClockString());
+   return playerClock_;
 }
 
 ChessClock K3ChessSettings::engineClock() const
 {
-   return stringToClock(engineClockString());
+   return engineClock_;
 }
 
 QString K3ChessSettings::playerClockString() const
 {
-   return settings_.value("Game/PlayerClock", cDefaultPlayerClockSetup).toString();
+   return values_.playerClock;
 }
 
 QString K3ChessSettings::engineClockString() const
 {
-   return settings_.value("Game/EngineClock", cDefaultEngineClockSetup).toString();
+   return values_.engineClock;
 }
 
 bool K3ChessSettings::autoSaveGames() const
 {
-   return settings_.value("Misc/AutoSaveGames", false).toBool();
+   return values_.autoSaveGames;
 }
 
 bool K3ChessSettings::canPonder() const
 {
-   return settings_.value("Game/Pondering", false).toBool();
+   return values_.canPonder;
 }
 
 bool K3ChessSettings::keyColumnSelect() const
 {
-   return settings_.value("Input/KeyCoordSelect", true).toBool();
+   return values_.keyColumnSelect;
 }
 
 bool K3ChessSettings::keyPieceSelect() const
 {
-   return settings_.value("Input/KeyPieceSelect", true).toBool();
+   return values_.keyPieceSelect;
 }
 
 QString K3ChessSettings::keymapFile() const
@@ -222,106 +384,143 @@ QString K3ChessSettings::keymapFile() const
    return cDefaultKeymapIniFile;
 }
 
-void K3ChessSettings::enumEngines(QDir dir)
+const K3ChessSettings::EngineMap& K3ChessSettings::engines() const
 {
-    enumEnginesProc(dir);
-    if(!engines_.empty() &&
-          engines_.find(settings_.value("Engine",
-             QString()).toString())==engines_.end())
-    {
-       settings_.setValue("Engine", engines_.begin()->first);
-    }
+   if(!enginesEnumerated_)
+   {
+      // engines must have "engine.ini"-files with descriptions
+      enumEngines("./engines");
+      enginesEnumerated_ = true;
+      discovery_.save();
+   }
+   return engines_;
 }
 
-void K3ChessSettings::enumEnginesProc(QDir dir)
+const K3ChessSettings::NameMap& K3ChessSettings::piecesStyles() const
 {
-   dir.setFilter(QDir::Files | QDir::Dirs);
-   QFileInfoList items = dir.entryInfoList();
-   foreach(QFileInfo fi, items)
+   if(!piecesStylesEnumerated_)
    {
-      if(fi.isDir())
-      {
-         if(!fi.fileName().startsWith("."))
-            enumEnginesProc(fi.filePath());
-      }
-      else if(fi.fileName()=="engine.ini")
-      {
-         EngineInfo info;
-         if(readEngineInfo(fi.absoluteFilePath(), info))
-         {
-            engines_.insert(std::make_pair(info.name, info));
-         }
-      }
+      enumPiecesStyles("./pieces");
+      piecesStylesEnumerated_ = true;
+      discovery_.save();
    }
+   return piecesStyles_;
 }
 
-void K3ChessSettings::enumPiecesStyles(QDir dir)
+const K3ChessSettings::NameMap& K3ChessSettings::locales() const
 {
-   dir.setFilter(QDir::Files | QDir::Dirs);
-   QFileInfoList items = dir.entryInfoList();
-   foreach(QFileInfo fi, items)
+   if(!localesEnumerated_)
    {
-      if(fi.isDir())
+      enumLocales("./locales");
+      localesEnumerated_ = true;
+      discovery_.save();
+   }
+   return locales_;
+}
+
+void K3ChessSettings::enumEngines(const QString& dirPath) const
+{
+   QStringList files = discovery_.findFiles(dirPath, isEngineIniFile);
+   foreach(QString file, files)
+   {
+      QFileInfo fi(file);
+      EngineInfo info;
+      bool valid = false;
+      //
+      QByteArray data;
+      if(discovery_.cachedData(fi, data))
       {
-         if(!fi.fileName().startsWith("."))
-            enumPiecesStyles(fi.filePath());
+         QDataStream in(data);
+         in.setVersion(QDataStream::Qt_4_0);
+         in >> valid;
+         if(valid) in >> info;
       }
-      else if(fi.fileName().contains('.'))
+      else
       {
-         QString ext = fi.fileName().section('.', -1, -1);
-         QString name = fi.fileName().left(fi.fileName().length()-ext.length()-1);
-         if(ext=="png" || ext=="bmp" || ext=="jpg")
-         {
-            piecesStyles_.insert(std::make_pair(name, fi.filePath()));
-         }
+         valid = readEngineInfo(fi.absoluteFilePath(), info);
+         //
+         QDataStream out(&data, QIODevice::WriteOnly);
+         out.setVersion(QDataStream::Qt_4_0);
+         out << valid;
+         if(valid) out << info;
+         discovery_.setData(fi, data);
+      }
+      //
+      if(valid)
+      {
+         engines_.insert(std::make_pair(info.name, info));
       }
    }
-   //
-   if(!piecesStyles_.empty() &&
-         piecesStyles_.find(settings_.value("Board/PiecesStyle",
-            QString()).toString())==piecesStyles_.end())
+}
+
+void K3ChessSettings::enumPiecesStyles(const QString& dirPath) const
+{
+   QStringList files = discovery_.findFiles(dirPath, isPieceImageFile);
+   foreach(QString file, files)
    {
-      settings_.setValue("Board/PiecesStyle", piecesStyles_.begin()->first);
+      QFileInfo fi(file);
+      piecesStyles_.insert(std::make_pair(fi.completeBaseName(), fi.filePath()));
    }
 }
 
-void K3ChessSettings::enumLocales(QDir dir)
+void K3ChessSettings::enumLocales(const QString& dirPath) const
 {
-   dir.setFilter(QDir::Files | QDir::Dirs);
-   QFileInfoList items = dir.entryInfoList();
-   foreach(QFileInfo fi, items)
+   QStringList files = discovery_.findFiles(dirPath, isLocaleIniFile);
+   foreach(QString file, files)
    {
-      if(fi.isDir())
+      QFileInfo fi(file);
+      QString name;
+      //
+      QByteArray data;
+      if(discovery_.cachedData(fi, data))
       {
-         if(!fi.fileName().startsWith("."))
-            enumLocales(fi.filePath());
+         name = QString::fromUtf8(data);
       }
-      else if(fi.fileName().endsWith(".ini"))
+      else
       {
-         QSettings ini(fi.filePath(), QSettings::IniFormat);
-         ini.setIniCodec(QTextCodec::codecForName("UTF-8"));
-         QString name = ini.value("Info/LocaleName", QString()).toString();
-         if(!name.isEmpty())
-         {
-            locales_.insert(std::make_pair(name, fi.filePath()));
-         }
+         name = readLocaleName(fi.filePath());
+         discovery_.setData(fi, name.toUtf8());
+      }
+      //
+      if(!name.isEmpty())
+      {
+         locales_.insert(std::make_pair(name, fi.filePath()));
       }
    }
+}
+
+QString K3ChessSettings::readLocaleName(const QString& localeIniFile)
+{
+   // only the [Info] section at the top of the file is read, parsing
+   // every locale file with QSettings took most of the enumeration time
+   QFile file(localeIniFile);
+   if(!file.open(QIODevice::ReadOnly|QIODevice::Text)) return QString();
    //
-   QString lname = settings_.value("Locale",
-                                    cDefaultLocaleName).toString();
+   QTextStream in(&file);
+   in.setCodec("UTF-8");
    //
-   if((!locales_.empty() && locales_.find(lname)==locales_.end()) ||
-       (locales_.empty() && lname!=cDefaultLocaleName))
+   bool inInfo = false;
+   while(!in.atEnd())
    {
-      settings_.setValue("Locale", cDefaultLocaleName);
+      QString line = in.readLine().trimmed();
+      if(line.startsWith('['))
+      {
+         if(inInfo) break; // no name in the [Info] section
+         inInfo = line=="[Info]";
+      }
+      else if(inInfo && line.startsWith("LocaleName"))
+      {
+         QString key = line.section('=', 0, 0).trimmed();
+         if(key=="LocaleName") return line.section('=', 1).trimmed();
+      }
    }
+   return QString();
 }
 
 QStringList K3ChessSettings::getEngineNames() const
 {
    QStringList qsl;
-   std::map<QString, EngineInfo>::const_iterator it = engines_.begin(), itEnd = engines_.end();
+   EngineMap::const_iterator it = engines().begin(), itEnd = engines().end();
    for(;it!=itEnd;++it)
    {
       qsl.append(it->first);
@@ -332,7 +531,7 @@ QStringList K3ChessSettings::getEngineNames() const
 QStringList K3ChessSettings::getPiecesStyleNames() const
 {
    QStringList qsl;
-   std::map<QString, QString>::const_iterator it = piecesStyles_.begin(), itEnd = piecesStyles_.end();
+   NameMap::const_iterator it = piecesStyles().begin(), itEnd = piecesStyles().end();
    for(;it!=itEnd;++it)
    {
       qsl.append(it->first);
@@ -343,7 +542,7 @@ QStringList K3ChessSettings::getPiecesStyleNames() const
 QStringList K3ChessSettings::getLocaleNames() const
 {
    QStringList qsl;
-   std::map<QString, QString>::const_iterator it = locales_.begin(), itEnd = locales_.end();
+   NameMap::const_iterator it = locales().begin(), itEnd = locales().end();
    for(;it!=itEnd;++it)
    {
       qsl.append(it->first);
@@ -357,8 +556,8 @@ QStringList K3ChessSettings::getLocaleNames() const
 
 QString K3ChessSettings::pieceImageFileFromName(const QString& name) const
 {
-   std::map<QString, QString>::const_iterator it = piecesStyles_.find(name);
-   if(it==piecesStyles_.end())
+   NameMap::const_iterator it = piecesStyles().find(name);
+   if(it==piecesStyles().end())
    {
       return QString();
    }
@@ -370,8 +569,8 @@ QString K3ChessSettings::pieceImageFileFromName(const QString& name) const
 
 QString K3ChessSettings::localeIniFilePathFromName(const QString& name) const
 {
-   std::map<QString, QString>::const_iterator it = locales_.find(name);
-   if(it==locales_.end())
+   NameMap::const_iterator it = locales().find(name);
+   if(it==locales().end())
    {
       return QString(); // indicates default (hard coded) locale
    }
@@ -383,64 +582,79 @@ QString K3ChessSettings::localeIniFilePathFromName(const QString& name) const
 
 void K3ChessSettings::setPiecesStyle(const QString& name)
 {
-   if(name==settings_.value("Board/PiecesStyle").toString()) return;
-   settings_.setValue("Board/PiecesStyle", name);
+   if(name==values_.piecesStyle) return;
+   values_.piecesStyle = name;
+   storeValue("Board/PiecesStyle", name);
+   emit piecesStyleChanged(name);
    emit boardStyleChanged();
 }
 
 void K3ChessSettings::setLocaleName(const QString& name)
 {
-   if(locales_.empty() || name==settings_.value("Locale").toString()) return;
-   settings_.setValue("Locale", name);
+   if(locales().empty() || name==values_.localeName) return;
+   values_.localeName = name;
+   storeValue("Locale", name);
    emit localeChanged();
 }
 
 void K3ChessSettings::setCanPonder(bool value)
 {
-   if(value==canPonder()) return;
-   settings_.setValue("Game/Pondering", value);
+   if(value==values_.canPonder) return;
+   values_.canPonder = value;
+   storeValue("Game/Pondering", value);
    emit ponderingChanged();
 }
 
 void K3ChessSettings::setDrawMoveArrow(bool value)
 {
-   if(value==drawMoveArrow()) return;
-   settings_.setValue("Board/DrawMoveArrow", value);
+   if(value==values_.drawMoveArrow) return;
+   values_.drawMoveArrow = value;
+   storeValue("Board/DrawMoveArrow", value);
+   emit drawMoveArrowChanged(value);
    emit boardStyleChanged();
 }
 
 void K3ChessSettings::setDrawCoordinates(bool value)
 {
-   if(value==drawCoordinates()) return;
-   settings_.setValue("Board/DrawCoordinates", value);
+   if(value==values_.drawCoordinates) return;
+   values_.drawCoordinates = value;
+   storeValue("Board/DrawCoordinates", value);
+   emit drawCoordinatesChanged(value);
    emit boardStyleChanged();
 }
 
 void K3ChessSettings::setAutoSaveGames(bool value)
 {
-   if(value==autoSaveGames()) return;
-   settings_.setValue("Misc/AutoSaveGames", value);
+   if(value==values_.autoSaveGames) return;
+   values_.autoSaveGames = value;
+   storeValue("Misc/AutoSaveGames", value);
+   emit autoSaveGamesChanged(value);
 }
 
 void K3ChessSettings::setPlayerName(const QString& name)
 {
-   if(name==playerName()) return;
-   settings_.setValue("PlayerName", name);
+   if(name==values_.playerName) return;
+   values_.playerName = name;
+   storeValue("PlayerName", name);
    emit playerNameChanged();
 }
 
 void K3ChessSettings::setPlayerClock(const QString& str)
 {
    QString s = containsDigits(str) ? str : QString("--");
-   if(playerClockString()==s) return;
-   settings_.setValue("Game/PlayerClock", s);
+   if(values_.playerClock==s) return;
+   values_.playerClock = s;
+   playerClock_ = stringToClock(s);
+   storeValue("Game/PlayerClock", s);
    emit timeSettingsChanged();
 }
 
 void K3ChessSettings::setEngineClock(const QString& str)
 {
-   if(engineClockString()==str) return;
-   settings_.setValue("Game/EngineClock", str);
+   if(values_.engineClock==str) return;
+   values_.engineClock = str;
+   engineClock_ = stringToClock(str);
+   storeValue("Game/EngineClock", str);
    emit timeSettingsChanged();
 }
 
@@ -451,18 +665,30 @@ const Profile& K3ChessSettings::profile() const
 
 void K3ChessSettings::flush()
 {
+   if(pendingValues_.empty()) return;
+   //
+   std::map<QString, QVariant>::const_iterator it = pendingValues_.begin(),
+                                               itEnd = pendingValues_.end();
+   for(;it!=itEnd;++it)
+   {
+      settings_.setValue(it->first, it->second);
+   }
+   pendingValues_.clear();
+   //
    settings_.sync();
 }
 
 bool K3ChessSettings::showMoveHints() const
 {
-   return settings_.value("Board/ShowMoveHints", true).toBool();
+   return values_.showMoveHints;
 }
 
 void K3ChessSettings::setShowMoveHints(bool value)
 {
-   if(value==showMoveHints()) return;
-   settings_.setValue("Board/ShowMoveHints", value);
+   if(value==values_.showMoveHints) return;
+   values_.showMoveHints = value;
+   storeValue("Board/ShowMoveHints", value);
+   emit showMoveHintsChanged(value);
    emit boardStyleChanged();
 }
 
@@ -564,13 +790,15 @@ bool K3ChessSettings::readEngineInfo(const QString& engineIniFile,
 
 bool K3ChessSettings::quickSingleMoveSelection() const
 {
-   return settings_.value("QuickSingleMoveSelection", true).toBool();
+   return values_.quickSingleMoveSelection;
 }
 
 void K3ChessSettings::setQuickSingleMoveSelection(bool value)
 {
-   if(value==quickSingleMoveSelection()) return;
-   settings_.setValue("QuickSingleMoveSelection", value);
+   if(value==values_.quickSingleMoveSelection) return;
+   values_.quickSingleMoveSelection = value;
+   storeValue("QuickSingleMoveSelection", value);
+   emit quickSingleMoveSelectionChanged(value);
    emit inputSettingsChanged();
 }
 
@@ -579,38 +807,48 @@ QString K3ChessSettings::lastGameFile() const
    return cDefaultLastGameFile;
 }
 
+QString K3ChessSettings::lastGameJournalFile() const
+{
+   return cDefaultLastGameJournalFile;
+}
+
 bool K3ChessSettings::isChess960() const
 {
-   return settings_.value("Chess960", false).toBool();
+   return values_.chess960;
 }
 
 void K3ChessSettings::setChess960(bool value)
 {
-   settings_.setValue("Chess960", value);
+   if(value==values_.chess960) return;
+   values_.chess960 = value;
+   storeValue("Chess960", value);
+   emit chess960Changed(value);
 }
 
 QString K3ChessSettings::currentEngineProfile() const
 {
-   return settings_.value("EngineProfile", "Default").toString();
+   return values_.engineProfile;
 }
 
 void K3ChessSettings::setEngine(const QString& engineName, const QString& profileName)
 {
    bool changed = false;
-   if(engineName!=settings_.value("Engine").toString())
+   if(engineName!=values_.engineName)
    {
-      settings_.setValue("Engine", engineName);
+      values_.engineName = engineName;
+      storeValue("Engine", engineName);
       changed = true;
    }
    //
-   if(profileName!=currentEngineProfile())
+   if(profileName!=values_.engineProfile)
    {
       if(engineInfo().startupCommands.find(profileName)==engineInfo().startupCommands.end())
       {
          assert(false);
          return; // attempt to set a non-existing profile
       }
-      settings_.setValue("EngineProfile", profileName);
+      values_.engineProfile = profileName;
+      storeValue("EngineProfile", profileName);
       changed = true;
    }
    //
@@ -619,8 +857,8 @@ void K3ChessSettings::setEngine(const QString& engineName, const QString& profil
 
 const EngineInfo& K3ChessSettings::engineInfo(const QString &engineName) const
 {
-   std::map<QString, EngineInfo>::const_iterator it = engines_.find(engineName);
-   if(it==engines_.end())
+   EngineMap::const_iterator it = engines().find(engineName);
+   if(it==engines().end())
    {
       static const EngineInfo dummy;
       return dummy;
@@ -633,67 +871,114 @@ const EngineInfo& K3ChessSettings::engineInfo(const QString &engineName) const
 
 void K3ChessSettings::setCoordinateMoveInput(bool value)
 {
-   if(coordinateMoveInput()==value) return;
-   settings_.setValue("CoordinateMoveInput", value);
+   if(values_.coordinateMoveInput==value) return;
+   values_.coordinateMoveInput = value;
+   storeValue("CoordinateMoveInput", value);
+   emit coordinateMoveInputChanged(value);
    emit inputSettingsChanged();
 }
 
 bool K3ChessSettings::coordinateMoveInput() const
 {
-   return settings_.value("CoordinateMoveInput", false).toBool();
+   return values_.coordinateMoveInput;
 }
 
 QString K3ChessSettings::initialPositionFen() const
 {
-   return settings_.value("InitialPosition", QString(cStandardInitialFen.c_str())).toString();
+   return values_.initialPositionFen;
 }
 
 void K3ChessSettings::setInitialPositionFen(const QString &fen)
 {
-   settings_.setValue("InitialPosition", fen);
+   if(fen==values_.initialPositionFen) return;
+   values_.initialPositionFen = fen;
+   storeValue("InitialPosition", fen);
 }
 
 int K3ChessSettings::boardMargins() const
 {
-   int value = settings_.value("Board/Margins", cDefaultBoardMargins).toInt();
-   if(value<0) return 0;
-   else return value;
+   if(values_.boardMargins<0) return 0;
+   else return values_.boardMargins;
 }
 
 void K3ChessSettings::setBoardMargins(int value)
 {
-   if(value==boardMargins()) return;
-   settings_.setValue("Board/Margins", value);
+   if(value==values_.boardMargins) return;
+   values_.boardMargins = value;
+   storeValue("Board/Margins", value);
+   emit boardMarginsChanged(value);
    emit boardStyleChanged();
 }
 
 bool K3ChessSettings::showGameClock() const
 {
-   return settings_.value("ShowGameClock", false).toBool();
+   return values_.showGameClock;
 }
 
 void K3ChessSettings::setShowGameClock(bool value)
 {
-   settings_.setValue("ShowGameClock", value);
+   if(value==values_.showGameClock) return;
+   values_.showGameClock = value;
+   storeValue("ShowGameClock", value);
+   emit showGameClockChanged(value);
 }
 
 bool K3ChessSettings::showCapturedPieces() const
 {
-   return settings_.value("ShowCapturedPieces", false).toBool();
+   return values_.showCapturedPieces;
 }
 
 void K3ChessSettings::setShowCapturedPieces(bool value)
 {
-   settings_.setValue("ShowCapturedPieces", value);
+   if(value==values_.showCapturedPieces) return;
+   values_.showCapturedPieces = value;
+   storeValue("ShowCapturedPieces", value);
+   emit showCapturedPiecesChanged(value);
 }
 
 bool K3ChessSettings::useRussianNotation() const
 {
-   return settings_.value("UseRussianNotation", false).toBool();
+   return values_.useRussianNotation;
 }
 
 void K3ChessSettings::setUseRussianNotation(bool value)
 {
-   settings_.setValue("UseRussianNotation", value);
+   if(value==values_.useRussianNotation) return;
+   values_.useRussianNotation = value;
+   storeValue("UseRussianNotation", value);
+   emit useRussianNotationChanged(value);
+}
+
+bool K3ChessSettings::showOpeningExplorer() const
+{
+   return values_.showOpeningExplorer;
+}
+
+QString K3ChessSettings::spriteCacheDir() const
+{
+   return values_.spriteCacheDir;
+}
+
+unsigned K3ChessSettings::spriteGrayLevels() const
+{
+   return values_.spriteGrayLevels;
+}
+
+bool K3ChessSettings::ditherSprites() const
+{
+   return values_.ditherSprites;
+}
+
+unsigned K3ChessSettings::fullRefreshInterval() const
+{
+   return values_.fullRefreshInterval;
+}
+
+void K3ChessSettings::setShowOpeningExplorer(bool value)
+{
+   if(value==values_.showOpeningExplorer) return;
+   values_.showOpeningExplorer = value;
+   storeValue("Database/ShowExplorer", value);
+   emit showOpeningExplorerChanged(value);
 }
 
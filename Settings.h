@@ -7,6 +7,9 @@
 #include "Singletons.h"
 #include "GameProfile.h"
 #include "EngineInfo.h"
+#include "DiscoveryIndex.h"
+
+#include <QVariant>
 
 #include <map>
 
@@ -42,6 +45,13 @@ public:
    QString localeIniFilePath() const;
 
    QString pgnFilePath() const;
+   QString pgnDatabaseFile() const; // PGN file browsed by "Open game" command
+   QString gameCollectionFile() const; // binary games imported from pgnDatabaseFile()
+   QString openingBookFile() const;    // Polyglot book used for engine opening moves
+   QString polyglotKeysFile() const;   // Polyglot Random64 keys (hex numbers)
+   bool useOpeningBook() const;        // engine opening moves are played from the book
+   QString syzygyPath() const;         // directory with Syzygy tablebase files
+   bool adjudicateByTablebases() const; // engine vs engine games end as soon as the tablebases know the result, humans get a hint
    QString playerName() const;
 
    ChessClock playerClock() const;
@@ -62,6 +72,7 @@ public:
 
    QString keymapFile() const;
    QString lastGameFile() const;
+   QString lastGameJournalFile() const; // moves of the game in progress, written as they are played
 
    bool autoSaveGames() const; // if true, games will be saved to pgn file automatically, without prompt
    bool canPonder() const; // global ponder setting (may be overridden by internal engine parameters)
@@ -72,6 +83,7 @@ public:
 
    QStringList getEngineNames() const;
    QStringList getPiecesStyleNames() const;
+   QString pieceImageFileFromName(const QString& name) const;
    QStringList getLocaleNames() const;
 
    void setEngine(const QString& engineName, const QString& profileName);
@@ -103,7 +115,14 @@ public:
    bool useRussianNotation() const; // use Russian chess move notation
    void setUseRussianNotation(bool value);
 
-   void flush();
+   bool showOpeningExplorer() const; // show PGN database move statistics for the current position
+   QString spriteCacheDir() const; // scaled pieces images are stored here, empty - no disk cache
+   unsigned spriteGrayLevels() const; // pieces images are reduced to this many gray levels (e.g. 16 for e-ink), 0 - full color
+   bool ditherSprites() const;        // ordered dithering when reducing gray levels
+   unsigned fullRefreshInterval() const; // the screen refresh after every n-th move repaints the whole window (clears e-ink ghosting), 0 - never
+   void setShowOpeningExplorer(bool value);
+
+   void flush(); // writes changed values to the ini file
 
 signals:
    void engineChanged();
@@ -113,27 +132,100 @@ signals:
    void ponderingChanged();
    void playerNameChanged();
    void localeChanged();
+   //
+   // fine-grained notifications, emitted together with the signals above
+   void piecesStyleChanged(const QString& name);
+   void drawCoordinatesChanged(bool value);
+   void drawMoveArrowChanged(bool value);
+   void showMoveHintsChanged(bool value);
+   void boardMarginsChanged(int value);
+   void showGameClockChanged(bool value);
+   void showCapturedPiecesChanged(bool value);
+   void coordinateMoveInputChanged(bool value);
+   void quickSingleMoveSelectionChanged(bool value);
+   void autoSaveGamesChanged(bool value);
+   void useRussianNotationChanged(bool value);
+   void showOpeningExplorerChanged(bool value);
+   void chess960Changed(bool value);
 
 private:
-   void enumEngines(QDir dir);
-   void enumEnginesProc(QDir dir);
-   bool readEngineInfo(const QString& engineIniFile, EngineInfo& info);
-   void enumPiecesStyles(QDir dir);
-   void enumLocales(QDir dir);
+   typedef std::map<QString, EngineInfo> EngineMap;
+   typedef std::map<QString, QString> NameMap;
+
+   // directories are enumerated on first use rather than on startup,
+   // unchanged files are not parsed again (see DiscoveryIndex)
+   const EngineMap& engines() const;
+   const NameMap& piecesStyles() const;
+   const NameMap& locales() const;
+
+   void enumEngines(const QString& dirPath) const;
+   static bool readEngineInfo(const QString& engineIniFile, EngineInfo& info);
+   void enumPiecesStyles(const QString& dirPath) const;
+   void enumLocales(const QString& dirPath) const;
+   static QString readLocaleName(const QString& localeIniFile);
 
-   QString pieceImageFileFromName(const QString& name) const;
    QString localeIniFilePathFromName(const QString& name) const;
 
    void initKeyboardProfile();
 
+   void loadSnapshot();
+   void storeValue(const QString& key, const QVariant& value); // queues value for flush()
+
 private:
+   // typed copy of K3Chess.ini values, read once on startup
+   // (getters are called on every move and must not touch QSettings)
+   struct Snapshot
+   {
+      QString engineName;
+      QString engineProfile;
+      QString piecesStyle;
+      QString localeName;
+      QString pgnFilePath;
+      QString pgnDatabaseFile;
+      QString gameCollectionFile;
+      QString openingBookFile;
+      QString polyglotKeysFile;
+      QString syzygyPath;
+      QString spriteCacheDir;
+      QString playerName;
+      QString playerClock;
+      QString engineClock;
+      QString initialPositionFen;
+      int boardMargins;
+      unsigned fullRefreshInterval;
+      unsigned spriteGrayLevels;
+      bool ditherSprites;
+      bool drawCoordinates;
+      bool drawMoveArrow;
+      bool showMoveHints;
+      bool showGameClock;
+      bool showCapturedPieces;
+      bool coordinateMoveInput;
+      bool quickSingleMoveSelection;
+      bool keyColumnSelect;
+      bool keyPieceSelect;
+      bool autoSaveGames;
+      bool canPonder;
+      bool chess960;
+      bool useRussianNotation;
+      bool showOpeningExplorer;
+      bool useOpeningBook;
+      bool adjudicateByTablebases;
+   };
+
    QSettings settings_;
+   Snapshot values_;
+   std::map<QString, QVariant> pendingValues_; // changed values not yet written to settings_
    ChessClock playerClock_;
    ChessClock engineClock_;
    Profile profile_;
-   std::map<QString, EngineInfo> engines_; // maps engine names to engine executable paths
-   std::map<QString, QString> piecesStyles_; // maps piece style names to piece image paths
-   std::map<QString, QString> locales_; // maps locale names to locale ini files
+   mutable DiscoveryIndex discovery_;
+   mutable EngineMap engines_; // maps engine names to engine executable paths
+   mutable NameMap piecesStyles_; // maps piece style names to piece image paths
+   mutable NameMap locales_; // maps locale names to locale ini files
+   mutable bool enginesEnumerated_;
+   mutable bool piecesStylesEnumerated_;
+   mutable bool localesEnumerated_;
 };
 
 #endif
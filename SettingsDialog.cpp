@@ -236,6 +236,8 @@ void SettingsDialog::applyChanges()
    g_settings.setEngineClock(ui->cmbEngineTime->currentText());
    //
    g_settings.setBoardMargins(ui->spinBoardMargins->value());
+   //
+   g_settings.flush();
 }
 
 QString SettingsDialog::getCanonizedProfileName() const
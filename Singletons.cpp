@@ -7,6 +7,12 @@
 #include "GlobalUISession.h"
 #include "KeyMapper.h"
 #include "Random.h"
+#include "MoveCache.h"
+#include "RepaintScheduler.h"
+#include "PieceSpriteCache.h"
+#include "ChessGame.h"
+
+#include <QTime>
 
 #define __freeAndNil(T, p) { T *t = p; p = 0; delete t; }
 
@@ -21,20 +27,52 @@ LocalChessGui *localChessGui_ = 0;
 GlobalUISession *globalUISession_ = 0;
 KeyMapper *keyMapper_ = 0;
 Random *random_ = 0;
+MoveCache *moveCache_ = 0;
+RepaintScheduler *repaintScheduler_ = 0;
+PieceSpriteCache *pieceSprites_ = 0;
+
+// started during static initialization, i.e. close to program start
+struct StartupTimer
+{
+   QTime sinceStart;
+   int lastPhase;
+   //
+   StartupTimer() : lastPhase(0) { sinceStart.start(); }
+};
+
+StartupTimer startupTimer_;
+
+void logStartupPhase(const char *phase)
+{
+   int elapsed = startupTimer_.sinceStart.elapsed();
+   logString(QString("Startup: %1 %2 ms (+%3 ms)").arg(phase, -20).arg(elapsed, 5)
+             .arg(elapsed-startupTimer_.lastPhase).toStdString());
+   startupTimer_.lastPhase = elapsed;
+}
 
 void initialize()
 {
    assert(settings_==0 && chessRules_==0 && commandOptionDefs_==0 &&
           globalStrings_==0 && localChessGui_==0 && globalUISession_==0);
+   logStartupPhase("QApplication");
    // singleton initialization with explicit order
    random_ = new Random();
    settings_ = new K3ChessSettings();
+   logStartupPhase("settings");
    chessRules_ = new ChessRules();
+   moveCache_ = new MoveCache();
+   logStartupPhase("chess rules");
    globalStrings_ = new GlobalStrings();
+   logStartupPhase("strings");
    keyMapper_ = new KeyMapper();
    commandOptionDefs_ = new CommandOptionDefs();
+   logStartupPhase("keys and commands");
+   repaintScheduler_ = new RepaintScheduler();
+   pieceSprites_ = new PieceSpriteCache();
    localChessGui_ = new LocalChessGui();
+   logStartupPhase("main window");
    globalUISession_ = new GlobalUISession();
+   logStartupPhase("session");
 }
 
 void finalize()
@@ -44,9 +82,12 @@ void finalize()
    // singleton finalization with explicit order
    __freeAndNil(GlobalUISession, globalUISession_);
    __freeAndNil(LocalChessGui, localChessGui_);
+   __freeAndNil(PieceSpriteCache, pieceSprites_);
+   __freeAndNil(RepaintScheduler, repaintScheduler_);
    __freeAndNil(CommandOptionDefs, commandOptionDefs_);
    __freeAndNil(KeyMapper, keyMapper_);
    __freeAndNil(GlobalStrings, globalStrings_);
+   __freeAndNil(MoveCache, moveCache_);
    __freeAndNil(ChessRules, chessRules_);
    __freeAndNil(K3ChessSettings, settings_);
    __freeAndNil(Random, random_);
@@ -60,5 +101,8 @@ KeyMapper& keyMapper() { assert(keyMapper_); return *keyMapper_; }
 LocalChessGui& localChessGui() { assert(localChessGui_); return *localChessGui_; }
 GlobalUISession& globalUISession() { assert(globalUISession_); return *globalUISession_; }
 Random& random() { assert(random_); return *random_; }
+MoveCache& moveCache() { assert(moveCache_); return *moveCache_; }
+RepaintScheduler& repaintScheduler() { assert(repaintScheduler_); return *repaintScheduler_; }
+PieceSpriteCache& pieceSprites() { assert(pieceSprites_); return *pieceSprites_; }
 
 }
@@ -12,6 +12,9 @@ class CommandOptionDefs;
 class LocalChessGui;
 class GlobalUISession;
 class Random;
+class MoveCache;
+class RepaintScheduler;
+class PieceSpriteCache;
 
 namespace Singletons
 {
@@ -27,6 +30,13 @@ namespace Singletons
    LocalChessGui& localChessGui();
    GlobalUISession& globalUISession();
    Random& random();
+   MoveCache& moveCache();
+   RepaintScheduler& repaintScheduler();
+   PieceSpriteCache& pieceSprites();
+
+   // startup profiling: writes the time since program start and since the
+   // previous phase to the position log (singletons are timed by initialize() itself)
+   void logStartupPhase(const char *phase);
 }
 
 #define g_globalStrings Singletons::globalStrings()
@@ -37,5 +47,8 @@ namespace Singletons
 #define g_localChessGui Singletons::localChessGui()
 #define g_globalUISession Singletons::globalUISession()
 #define g_random Singletons::random()
+#define g_moveCache Singletons::moveCache()
+#define g_repaintScheduler Singletons::repaintScheduler()
+#define g_pieceSprites Singletons::pieceSprites()
 
 #endif
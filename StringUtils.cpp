@@ -1,5 +1,7 @@
 #include "StringUtils.h"
 
+#include <QDateTime>
+
 std::string toStdString(const QString& qs)
 {
     int n = qs.length();
@@ -175,3 +177,12 @@ QString extractFolderPath(const QString& path)
     //
     return folderPath;
 }
+
+qint64 fileModificationTime(const QFileInfo& fi)
+{
+#if QT_VERSION >= 0x040700
+   return fi.lastModified().toMSecsSinceEpoch();
+#else
+   return (qint64)fi.lastModified().toTime_t()*1000;
+#endif
+}
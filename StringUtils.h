@@ -3,6 +3,7 @@
 
 #include <string>
 #include <QString>
+#include <QFileInfo>
 
 std::string toStdString(const QString& qs); // workaround for QT compiled without STL support
 
@@ -19,4 +20,8 @@ void splitFilePath(const QString& path, QString& folderPath, QString& fileName,
 QString extractFileName_NoExt(const QString& path);
 QString extractFolderPath(const QString& path);
 
+// modification time in ms since the epoch, stored by the index and cache
+// files to detect changed sources (QDateTime::toTime_t() is deprecated in Qt 5)
+qint64 fileModificationTime(const QFileInfo& fi);
+
 #endif
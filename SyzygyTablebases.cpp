@@ -0,0 +1,203 @@
+#include "SyzygyTablebases.h"
+#include "Settings.h"
+#include "StringUtils.h"
+
+#include <string.h>
+
+#ifdef CONFIG_SYZYGY
+extern "C"
+{
+#include "tbprobe.h"
+}
+#endif
+
+namespace
+{
+
+bool initialized = false;
+
+#ifdef CONFIG_SYZYGY
+
+// position in the form expected by Fathom (bit 0 is a1, bit 63 is h8)
+struct Bitboards
+{
+   quint64 white, black;
+   quint64 kings, queens, rooks, bishops, knights, pawns;
+   unsigned nPieces;
+   unsigned ep;
+};
+
+void toBitboards(const ChessPosition& position, Bitboards& b)
+{
+   memset(&b, 0, sizeof(b));
+   //
+   ChessCoord coord;
+   for(coord.row=1; coord.row<=position.maxRow(); ++coord.row)
+   {
+      for(coord.col=1; coord.col<=position.maxCol(); ++coord.col)
+      {
+         ChessPiece piece = position.cell(coord);
+         if(piece.type()==ptNone) continue;
+         //
+         quint64 bit = Q_UINT64_C(1) << ((coord.row-1)*8 + (coord.col-1));
+         if(piece.color()==pcWhite) b.white |= bit; else b.black |= bit;
+         switch(piece.type())
+         {
+            case ptKing:   b.kings |= bit; break;
+            case ptQueen:  b.queens |= bit; break;
+            case ptRook:   b.rooks |= bit; break;
+            case ptBishop: b.bishops |= bit; break;
+            case ptKnight: b.knights |= bit; break;
+            case ptPawn:   b.pawns |= bit; break;
+         }
+         ++b.nPieces;
+      }
+   }
+   //
+   // en passant target square is behind the pawn that has just moved
+   ChessCoord pawnJump = position.pawnJump();
+   if(pawnJump!=ChessCoord())
+   {
+      RowValue row = position.sideToMove()==pcWhite ? pawnJump.row+1 : pawnJump.row-1;
+      b.ep = (row-1)*8 + (pawnJump.col-1);
+   }
+}
+
+bool canProbe(const ChessPosition& position, const Bitboards& b)
+{
+   return position.castlingFlags()==0 && b.nPieces<=TB_LARGEST;
+}
+
+TablebaseResult toResult(unsigned wdl)
+{
+   switch(wdl)
+   {
+      case TB_LOSS:         return tbLoss;
+      case TB_BLESSED_LOSS: /*fallthrough*/
+      case TB_DRAW:         /*fallthrough*/
+      case TB_CURSED_WIN:   return tbDraw;
+      case TB_WIN:          return tbWin;
+   }
+   return tbUnknown;
+}
+
+PieceType toPromotion(unsigned promotes)
+{
+   switch(promotes)
+   {
+      case TB_PROMOTES_QUEEN:  return ptQueen;
+      case TB_PROMOTES_ROOK:   return ptRook;
+      case TB_PROMOTES_BISHOP: return ptBishop;
+      case TB_PROMOTES_KNIGHT: return ptKnight;
+   }
+   return ptNone;
+}
+
+ChessCoord toCoord(unsigned square)
+{
+   return ChessCoord((square & 7) + 1, (square>>3) + 1);
+}
+
+#endif
+
+}
+
+bool SyzygyTablebases::isCompiledIn()
+{
+#ifdef CONFIG_SYZYGY
+   return true;
+#else
+   return false;
+#endif
+}
+
+bool SyzygyTablebases::initialize()
+{
+#ifdef CONFIG_SYZYGY
+   if(!initialized)
+   {
+      initialized = true;
+      tb_init(toStdString(g_settings.syzygyPath()).c_str());
+   }
+   return TB_LARGEST>0;
+#else
+   initialized = true;
+   return false;
+#endif
+}
+
+void SyzygyTablebases::release()
+{
+#ifdef CONFIG_SYZYGY
+   if(initialized) tb_free();
+#endif
+   initialized = false;
+}
+
+unsigned SyzygyTablebases::maxPieces()
+{
+#ifdef CONFIG_SYZYGY
+   return initialize() ? TB_LARGEST : 0;
+#else
+   return 0;
+#endif
+}
+
+TablebaseResult SyzygyTablebases::probeWDL(const ChessPosition& position)
+{
+#ifdef CONFIG_SYZYGY
+   if(!initialize()) return tbUnknown;
+   //
+   Bitboards b;
+   toBitboards(position, b);
+   if(!canProbe(position, b)) return tbUnknown;
+   //
+   // WDL tables assume the 50 move counter is zero; a result which depends
+   // on the counter is resolved by probeRoot() (DTZ tables)
+   if(position.halfCount()!=0)
+   {
+      ChessMove bestMove;
+      unsigned dtz = 0;
+      return probeRoot(position, bestMove, dtz);
+   }
+   //
+   unsigned result = tb_probe_wdl(b.white, b.black, b.kings, b.queens, b.rooks,
+                                  b.bishops, b.knights, b.pawns, 0, 0, b.ep,
+                                  position.sideToMove()==pcWhite);
+   if(result==TB_RESULT_FAILED) return tbUnknown;
+   return toResult(result);
+#else
+   Q_UNUSED(position);
+   return tbUnknown;
+#endif
+}
+
+TablebaseResult SyzygyTablebases::probeRoot(const ChessPosition& position,
+                                            ChessMove& bestMove, unsigned& dtz)
+{
+   bestMove = ChessMove();
+   dtz = 0;
+#ifdef CONFIG_SYZYGY
+   if(!initialize()) return tbUnknown;
+   //
+   Bitboards b;
+   toBitboards(position, b);
+   if(!canProbe(position, b)) return tbUnknown;
+   //
+   unsigned result = tb_probe_root(b.white, b.black, b.kings, b.queens, b.rooks,
+                                   b.bishops, b.knights, b.pawns, position.halfCount(), 0, b.ep,
+                                   position.sideToMove()==pcWhite, 0);
+   if(result==TB_RESULT_FAILED) return tbUnknown;
+   if(result==TB_RESULT_CHECKMATE) return tbLoss;
+   if(result==TB_RESULT_STALEMATE) return tbDraw;
+   //
+   bestMove.from = toCoord(TB_GET_FROM(result));
+   bestMove.to = toCoord(TB_GET_TO(result));
+   bestMove.promotion = toPromotion(TB_GET_PROMOTES(result));
+   dtz = TB_GET_DTZ(result);
+   return toResult(TB_GET_WDL(result));
+#else
+   Q_UNUSED(position);
+   return tbUnknown;
+#endif
+}
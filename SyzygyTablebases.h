@@ -0,0 +1,36 @@
+#ifndef __SyzygyTablebases_h
+#define __SyzygyTablebases_h
+
+#include "ChessPosition.h"
+#include "ChessMove.h"
+
+#include <QString>
+
+// game-theoretical result for the side to move
+// (cursed wins and blessed losses are draws under the 50 move rule)
+enum TablebaseResult { tbUnknown, tbLoss, tbDraw, tbWin };
+
+// SyzygyTablebases probes Syzygy WDL/DTZ endgame tablebases stored in a
+// local directory; the probing code itself is Fathom (tbprobe.c), which is
+// compiled in when its sources are found at build time (see K3Chess.pri),
+// otherwise all probes return tbUnknown
+// tablebase files are found on the first probe and memory-mapped on
+// demand, positions with castling rights are never probed
+
+class SyzygyTablebases
+{
+public:
+   static bool isCompiledIn();
+   static unsigned maxPieces(); // 0 if no tablebase files are found
+
+   static TablebaseResult probeWDL(const ChessPosition& position);
+   static TablebaseResult probeRoot(const ChessPosition& position,
+                                    ChessMove& bestMove, unsigned& dtz); // dtz in plies
+
+   static void release(); // unmaps the files, next probe looks for them again
+
+private:
+   static bool initialize();
+};
+
+#endif